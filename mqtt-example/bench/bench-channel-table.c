@@ -0,0 +1,130 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Channel routing: cost of routing a tagged line, and per-channel
+ *     throughput and latency with 8 and 16 channels sharing one link
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "bench.h"
+#include "channel-table.h"
+
+#include <stdio.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define LINE_MAX          40
+
+/* Simulated run: one publish can start every LINK_SLOT */
+#define SIM_TIME          (60 * CLOCK_SECOND)
+#define LINK_SLOT         (CLOCK_SECOND / 20)
+#define PAYLOAD_SIZE      128
+
+static char lines[CHANNEL_TABLE_MAX][LINE_MAX];
+static uint8_t lens[CHANNEL_TABLE_MAX];
+static char payload[PAYLOAD_SIZE];
+/*---------------------------------------------------------------------------*/
+static void
+make_lines(uint8_t channels)
+{
+  uint8_t i;
+
+  for(i = 0; i < channels; i++) {
+    lens[i] = snprintf(lines[i], LINE_MAX, "ch%u:CO=4.%02u,T=21.50", i, i);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Tag, lookup and queue, draining a batch whenever one fills up */
+static void
+bench_route(uint8_t channels)
+{
+  struct channel *c;
+  char name[48];
+  uint8_t tag;
+  uint32_t i;
+  uint64_t t0;
+
+  channel_table_init(CLOCK_SECOND, 4);
+  make_lines(channels);
+
+  t0 = bench_now();
+  for(i = 0; i < BENCH_ITERATIONS; i++) {
+    tag = channel_tag_len(lines[i % channels], lens[i % channels]);
+    c = channel_table_get(lines[i % channels], tag - 1);
+    if(!channel_table_put(c, lines[i % channels] + tag,
+                          lens[i % channels] - tag, i)) {
+      bench_sink += pub_queue_drain(&c->batch, payload, PAYLOAD_SIZE);
+      channel_table_put(c, lines[i % channels] + tag,
+                        lens[i % channels] - tag, i);
+    }
+  }
+  snprintf(name, sizeof(name), "channel-table: route, %u channels",
+           channels);
+  bench_report(name, bench_now() - t0, BENCH_ITERATIONS);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Channel i sends a line every (i + 1) * 100 ms. Even channels publish at
+ * most every second, odd ones every 4 lines. The link takes one publish per
+ * LINK_SLOT, most overdue batch first
+ */
+static void
+bench_latency(uint8_t channels)
+{
+  struct channel *c;
+  clock_time_t now;
+  clock_time_t period;
+  uint32_t bytes;
+  uint8_t tag;
+  uint8_t i;
+
+  channel_table_init(CLOCK_SECOND, 0);
+  make_lines(channels);
+  for(i = 0; i < channels; i++) {
+    c = channel_table_get(lines[i], channel_tag_len(lines[i], lens[i]) - 1);
+    if(i & 1) {
+      c->max_age = SIM_TIME;
+      c->max_lines = 4;
+    }
+  }
+
+  bytes = 0;
+  for(now = 0; now < SIM_TIME; now++) {
+    for(i = 0; i < channels; i++) {
+      period = (i + 1) * CLOCK_SECOND / 10;
+      if(now % period == 0) {
+        tag = channel_tag_len(lines[i], lens[i]);
+        channel_table_put(channel_table_get(lines[i], tag - 1),
+                          lines[i] + tag, lens[i] - tag, now);
+      }
+    }
+    if(now % LINK_SLOT == 0 && (c = channel_table_due(now)) != NULL) {
+      bytes += pub_queue_drain(&c->batch, payload, PAYLOAD_SIZE);
+      channel_table_published(c, now);
+    }
+  }
+
+  printf("channel-table: %u channels, %lu s, %lu payload bytes\n", channels,
+         (unsigned long)(SIM_TIME / CLOCK_SECOND), (unsigned long)bytes);
+  printf("  %-6s %5s %8s %5s %7s %13s %12s\n", "chan", "rule", "lines/s",
+         "pub", "dropped", "latency mean", "latency max");
+  for(i = 0; (c = channel_table_at(i)) != NULL; i++) {
+    printf("  %-6s %5s %8.1f %5u %7u %10lu ms %9lu ms\n", c->id,
+           i & 1 ? "n=4" : "1 s",
+           (double)c->lines * CLOCK_SECOND / SIM_TIME, c->published,
+           pub_queue_dropped(&c->batch),
+           c->published ?
+           (unsigned long)(c->latency_sum * 1000 / CLOCK_SECOND /
+                           c->published) : 0UL,
+           (unsigned long)(c->latency_max * 1000 / CLOCK_SECOND));
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+bench_channel_table(void)
+{
+  bench_route(8);
+  bench_route(CHANNEL_TABLE_MAX);
+  bench_latency(8);
+  bench_latency(CHANNEL_TABLE_MAX);
+}
+/*---------------------------------------------------------------------------*/
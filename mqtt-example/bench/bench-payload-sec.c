@@ -0,0 +1,115 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     AES-CCM payload protection: cost per payload with the key schedule
+ *     loaded once per session, as payload-sec.c does, against re-keying for
+ *     every payload, and the bytes it adds
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "bench.h"
+#include "payload-sec.h"
+#include "lib/ccm-star.h"
+
+#include <stdio.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define ITERATIONS (BENCH_ITERATIONS / 20)
+/* As in the header rows fill() writes */
+#define EPOCH      0x1a2b3c4d
+
+static const uint8_t node_id[PAYLOAD_SEC_ID_LEN] = {
+  0x00, 0x12, 0x4b, 0x0a, 0x0b, 0x0c
+};
+static const uint16_t body_lens[] = { 32, 64, 128, PAYLOAD_SEC_MAX_LEN };
+
+/* Header row, the longest body and the MIC */
+#define HDR_MAX 32
+static uint8_t buf[HDR_MAX + PAYLOAD_SEC_MAX_LEN + PAYLOAD_SEC_MIC_LEN];
+/*---------------------------------------------------------------------------*/
+static uint8_t
+fill(uint16_t body_len)
+{
+  uint8_t hdr_len;
+  uint16_t i;
+
+  hdr_len = snprintf((char *)buf, HDR_MAX, "$d:00124b0a0b0c,1a2b3c4d,%u\n",
+                     body_len);
+  for(i = 0; i < body_len; i++) {
+    buf[hdr_len + i] = "CO=421.83,LPG=1448.36\n"[i % 22];
+  }
+  return hdr_len;
+}
+/*---------------------------------------------------------------------------*/
+/* Decrypts a sealed payload in place, with the nonce payload_sec_seal() used */
+static int
+opens(uint8_t hdr_len, uint16_t len, uint16_t seq)
+{
+  uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+  uint8_t mic[PAYLOAD_SEC_MIC_LEN];
+  uint16_t body_len = len - hdr_len - PAYLOAD_SEC_MIC_LEN;
+
+  memset(nonce, 0, sizeof(nonce));
+  memcpy(nonce, node_id, PAYLOAD_SEC_ID_LEN);
+  nonce[PAYLOAD_SEC_ID_LEN] = EPOCH >> 24;
+  nonce[PAYLOAD_SEC_ID_LEN + 1] = (EPOCH >> 16) & 0xFF;
+  nonce[PAYLOAD_SEC_ID_LEN + 2] = (EPOCH >> 8) & 0xFF;
+  nonce[PAYLOAD_SEC_ID_LEN + 3] = EPOCH & 0xFF;
+  nonce[PAYLOAD_SEC_ID_LEN + 4] = seq >> 8;
+  nonce[PAYLOAD_SEC_ID_LEN + 5] = seq & 0xFF;
+
+  CCM_STAR.aead(nonce, buf + hdr_len, body_len, buf, hdr_len,
+                mic, PAYLOAD_SEC_MIC_LEN, 0);
+  return memcmp(mic, buf + hdr_len + body_len, PAYLOAD_SEC_MIC_LEN) == 0 &&
+    buf[hdr_len] == 'C';
+}
+/*---------------------------------------------------------------------------*/
+void
+bench_payload_sec(void)
+{
+  char name[48];
+  uint8_t hdr_len;
+  uint16_t len = 0;
+  uint8_t k;
+  uint32_t i;
+  uint64_t t0;
+
+  if(!payload_sec_init("000102030405060708090a0b0c0d0e0f")) {
+    printf("payload-sec: bad key\n");
+    return;
+  }
+
+  for(k = 0; k < sizeof(body_lens) / sizeof(body_lens[0]); k++) {
+    hdr_len = fill(body_lens[k]);
+
+    payload_sec_start(node_id);
+    t0 = bench_now();
+    for(i = 0; i < ITERATIONS; i++) {
+      len = payload_sec_seal(buf, hdr_len, hdr_len + body_lens[k], EPOCH, i);
+    }
+    snprintf(name, sizeof(name), "payload-sec: seal %u B", body_lens[k]);
+    bench_report(name, bench_now() - t0, ITERATIONS);
+
+    t0 = bench_now();
+    for(i = 0; i < ITERATIONS; i++) {
+      payload_sec_start(node_id);
+      len = payload_sec_seal(buf, hdr_len, hdr_len + body_lens[k], EPOCH, i);
+    }
+    snprintf(name, sizeof(name), "payload-sec: re-key + seal %u B",
+             body_lens[k]);
+    bench_report(name, bench_now() - t0, ITERATIONS);
+
+    printf("payload-sec: %u B payload -> %u B, +%u B (%.1f%%)\n",
+           hdr_len + body_lens[k], len, len - hdr_len - body_lens[k],
+           100.0 * (len - hdr_len - body_lens[k]) /
+           (hdr_len + body_lens[k]));
+
+    /* Sanity check: a payload opens again with the same key and nonce */
+    fill(body_lens[k]);
+    len = payload_sec_seal(buf, hdr_len, hdr_len + body_lens[k], EPOCH, 7);
+    if(!opens(hdr_len, len, 7)) {
+      printf("payload-sec: MISMATCH\n");
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
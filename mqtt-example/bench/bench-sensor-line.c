@@ -0,0 +1,107 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     UART line handling: the old snprintf(buf, remaining, line) copy, which
+ *     used the line as a format string and checked nothing, and the values
+ *     converted with strtod() as a C library equivalent of the parser's
+ *     work, against sensor_line_parse()
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "bench.h"
+#include "sensor-line.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+static const char *const lines[] = {
+  "CO=421.83,LPG=1448.36",
+  "CO=12.5,LPG=880.07,CH4=3.1,T=24.75,RH=61.2",
+  "421.83,1448.36,3.10,24.75",
+};
+#define LINE_COUNT (sizeof(lines) / sizeof(lines[0]))
+
+static char buf[128];
+/*---------------------------------------------------------------------------*/
+static int __attribute__((noinline))
+old_copy(const char *line)
+{
+  return snprintf(buf, sizeof(buf), line);
+}
+/*---------------------------------------------------------------------------*/
+/* Values only, keys skipped: a lower bound for the C library route */
+static int __attribute__((noinline))
+libc_convert(const char *line, struct sensor_record *rec)
+{
+  const char *p = line;
+  const char *eq;
+  char *e;
+
+  rec->count = 0;
+  do {
+    eq = strchr(p, '=');
+    if(eq != NULL && (strchr(p, ',') == NULL || eq < strchr(p, ','))) {
+      p = eq + 1;
+    }
+    if(rec->count == SENSOR_LINE_MAX_FIELDS) {
+      return SENSOR_LINE_TOO_MANY;
+    }
+    rec->field[rec->count++].value = strtod(p, &e) * SENSOR_LINE_SCALE;
+    if(e == p) {
+      return SENSOR_LINE_BAD_VALUE;
+    }
+    p = e;
+  } while(*p++ == ',');
+
+  return p[-1] == '\0' ? SENSOR_LINE_OK : SENSOR_LINE_SYNTAX;
+}
+/*---------------------------------------------------------------------------*/
+void
+bench_sensor_line(void)
+{
+  static struct sensor_record rec;
+  uint16_t len[LINE_COUNT];
+  uint32_t i;
+  uint64_t t0;
+
+  for(i = 0; i < LINE_COUNT; i++) {
+    len[i] = strlen(lines[i]);
+  }
+
+  t0 = bench_now();
+  for(i = 0; i < BENCH_ITERATIONS; i++) {
+    bench_sink += old_copy(lines[i % LINE_COUNT]);
+  }
+  bench_report("sensor-line: snprintf copy (old)", bench_now() - t0,
+               BENCH_ITERATIONS);
+
+  t0 = bench_now();
+  for(i = 0; i < BENCH_ITERATIONS; i++) {
+    bench_sink += libc_convert(lines[i % LINE_COUNT], &rec);
+    bench_sink += rec.field[0].value;
+  }
+  bench_report("sensor-line: strtod per value", bench_now() - t0,
+               BENCH_ITERATIONS);
+
+  t0 = bench_now();
+  for(i = 0; i < BENCH_ITERATIONS; i++) {
+    bench_sink += sensor_line_parse(lines[i % LINE_COUNT], len[i % LINE_COUNT],
+                                    &rec);
+    bench_sink += rec.field[0].value;
+  }
+  bench_report("sensor-line: parse and convert", bench_now() - t0,
+               BENCH_ITERATIONS);
+
+  /* Sanity check */
+  if(sensor_line_parse(lines[0], len[0], &rec) != SENSOR_LINE_OK ||
+     rec.count != 2 || rec.field[1].value != 144836 ||
+     strcmp(rec.field[1].key, "LPG") != 0 ||
+     sensor_line_parse("CO=%s%n", 7, &rec) != SENSOR_LINE_BAD_VALUE ||
+     sensor_line_parse("21474836.99", 11, &rec) != SENSOR_LINE_OVERFLOW ||
+     sensor_line_parse("21474836.47", 11, &rec) != SENSOR_LINE_OK ||
+     sensor_line_parse("CO=1,", 5, &rec) != SENSOR_LINE_SYNTAX) {
+    printf("sensor-line: MISMATCH\n");
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,37 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Runs the native micro benchmarks once and exits
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+/*---------------------------------------------------------------------------*/
+volatile uint32_t bench_sink;
+/*---------------------------------------------------------------------------*/
+PROCESS(bench_process, "Benchmarks");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+void
+bench_report(const char *name, uint64_t ticks, uint32_t n)
+{
+  printf("%-36s %10.1f %s/op\n", name, (double)ticks / n, BENCH_UNIT);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  bench_pub_hdr();
+  bench_sensor_line();
+  bench_channel_table();
+  bench_payload_sec();
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,50 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Helpers shared by the native micro benchmarks
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef BENCH_H_
+#define BENCH_H_
+/*---------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <time.h>
+/*---------------------------------------------------------------------------*/
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_UNIT "cycles"
+static inline uint64_t
+bench_now(void)
+{
+  return __rdtsc();
+}
+#else
+#define BENCH_UNIT "ns"
+static inline uint64_t
+bench_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+/*---------------------------------------------------------------------------*/
+#define BENCH_ITERATIONS 200000
+
+/* Results are folded into this so the compiler can't drop the work */
+extern volatile uint32_t bench_sink;
+
+/**
+ * \brief Print "name: X <unit>/op" for n operations that took ticks
+ */
+void bench_report(const char *name, uint64_t ticks, uint32_t n);
+/*---------------------------------------------------------------------------*/
+/* One entry point per benchmark file */
+void bench_pub_hdr(void);
+void bench_sensor_line(void);
+void bench_channel_table(void);
+void bench_payload_sec(void);
+/*---------------------------------------------------------------------------*/
+#endif /* BENCH_H_ */
+/*---------------------------------------------------------------------------*/
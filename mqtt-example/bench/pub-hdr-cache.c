@@ -0,0 +1,69 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Pre-serialised MQTT PUBLISH header, see pub-hdr-cache.h
+ *
+ *     Bytes 0..4 of buf are reserved for the fixed header byte and the
+ *     variable-length "remaining length" field, which are written right
+ *     aligned against the topic length at offset 5. The header therefore
+ *     starts at buf[start] and grows to the left for long payloads, without
+ *     moving the topic.
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "pub-hdr-cache.h"
+
+#include <stdint.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define MQTT_FHDR_PUBLISH       0x30
+#define MQTT_FHDR_RETAIN        0x01
+
+#define TOPIC_LEN_OFFSET        5
+/*---------------------------------------------------------------------------*/
+int
+pub_hdr_init(struct pub_hdr *h, const char *topic, uint8_t retain)
+{
+  size_t len = strlen(topic);
+
+  if(len > PUB_HDR_MAX_TOPIC_LEN) {
+    return 0;
+  }
+
+  h->topic_len = (uint8_t)len;
+  h->buf[TOPIC_LEN_OFFSET] = 0;
+  h->buf[TOPIC_LEN_OFFSET + 1] = h->topic_len;
+  memcpy(&h->buf[TOPIC_LEN_OFFSET + 2], topic, len);
+
+  /* The first pub_hdr_patch() writes the fixed header */
+  h->fhdr = MQTT_FHDR_PUBLISH | (retain ? MQTT_FHDR_RETAIN : 0);
+  h->start = TOPIC_LEN_OFFSET;
+  h->payload_len = UINT32_MAX;
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+const uint8_t *
+pub_hdr_patch(struct pub_hdr *h, uint32_t payload_len, uint8_t *hdr_len)
+{
+  uint32_t remaining;
+  uint8_t size;
+  uint8_t i;
+
+  if(payload_len != h->payload_len) {
+    remaining = 2 + h->topic_len + payload_len;
+    size = pub_hdr_len_size(remaining);
+
+    h->start = TOPIC_LEN_OFFSET - size - 1;
+    h->buf[h->start] = h->fhdr;
+    for(i = 1; i <= size; i++) {
+      h->buf[h->start + i] = (remaining & 0x7F) | (i < size ? 0x80 : 0);
+      remaining >>= 7;
+    }
+    h->payload_len = payload_len;
+  }
+
+  *hdr_len = TOPIC_LEN_OFFSET + 2 + h->topic_len - h->start;
+  return &h->buf[h->start];
+}
+/*---------------------------------------------------------------------------*/
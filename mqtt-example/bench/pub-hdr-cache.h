@@ -0,0 +1,55 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Pre-serialised MQTT PUBLISH header for a fixed topic.
+ *
+ *     The fixed header byte, the topic length and the topic itself are
+ *     encoded once per session by pub_hdr_init(). For each message only the
+ *     "remaining length" field depends on the payload, and pub_hdr_patch()
+ *     re-encodes just that field in place. The encoded header is followed on
+ *     the wire by the payload. QoS 0 only: there is no packet identifier.
+ *
+ *     apps/mqtt encodes its own header in mqtt_publish(), so the node has no
+ *     use for the cache and does not build it; it lives here so bench/ can
+ *     measure what it would save.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef PUB_HDR_CACHE_H_
+#define PUB_HDR_CACHE_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "pub-hdr.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+/* Fixed header byte + up to 4 bytes of remaining length + topic length */
+#define PUB_HDR_MAX_LEN (1 + 4 + 2 + PUB_HDR_MAX_TOPIC_LEN)
+/*---------------------------------------------------------------------------*/
+struct pub_hdr {
+  uint8_t buf[PUB_HDR_MAX_LEN];
+  uint8_t start;          /* First byte of the header currently in buf */
+  uint8_t fhdr;
+  uint8_t topic_len;
+  uint32_t payload_len;   /* Payload length the header was patched for */
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Encode the parts of the header that don't change
+ * \param h The cache
+ * \param topic Topic the messages are published to
+ * \param retain Non-zero to set the RETAIN flag
+ * \return 1 on success, 0 if the topic is longer than PUB_HDR_MAX_TOPIC_LEN
+ */
+int pub_hdr_init(struct pub_hdr *h, const char *topic, uint8_t retain);
+
+/**
+ * \brief Set the remaining length for a payload of payload_len bytes
+ * \return Pointer to the first byte of the encoded header
+ *
+ * The length of the header is returned in *hdr_len.
+ */
+const uint8_t *pub_hdr_patch(struct pub_hdr *h, uint32_t payload_len,
+                             uint8_t *hdr_len);
+/*---------------------------------------------------------------------------*/
+#endif /* PUB_HDR_CACHE_H_ */
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,252 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Ordered list of MQTT brokers with failover, see broker-list.h
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "broker-list.h"
+#include "str-arena.h"
+#include "sys/cc.h"
+
+#include <stdio.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define IS_DIGIT(c)      ((uint8_t)((c) - '0') < 10)
+
+/* Another broker must answer in less than 3/4 of the time to be worth it */
+#define FASTER(a, b)     ((uint32_t)(a) * 4 < (uint32_t)(b) * 3)
+/*---------------------------------------------------------------------------*/
+/* "a.b.c.d" into its four bytes; 0 if it is not exactly that */
+static int
+parse_ipv4(const char *p, const char *end, uint8_t *addr)
+{
+  uint16_t v;
+  uint8_t i;
+  uint8_t digits;
+
+  for(i = 0; i < 4; i++) {
+    v = 0;
+    digits = 0;
+    while(p < end && IS_DIGIT(*p) && digits < 3) {
+      v = v * 10 + (*p++ - '0');
+      digits++;
+    }
+    if(digits == 0 || v > 255) {
+      return 0;
+    }
+    addr[i] = v;
+    if(i < 3) {
+      if(p == end || *p != '.') {
+        return 0;
+      }
+      p++;
+    }
+  }
+
+  return p == end;
+}
+/*---------------------------------------------------------------------------*/
+static int
+parse_port(const char *p, const char *end, uint16_t *port)
+{
+  uint32_t v = 0;
+
+  if(p == end) {
+    return 0;
+  }
+  while(p < end) {
+    if(!IS_DIGIT(*p)) {
+      return 0;
+    }
+    v = v * 10 + (*p++ - '0');
+    if(v > 0xFFFF) {
+      return 0;
+    }
+  }
+  *port = v;
+
+  return v != 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+parse_entry(struct broker *b, const char *p, const char *end, uint16_t port,
+            const char *nat64)
+{
+  char buf[BROKER_LIST_HOST_LEN + 1];
+  const char *host_end;
+  const char *colon;
+  uint8_t v4[4];
+  int len;
+
+  b->port = port;
+
+  if(p < end && *p == '[') {
+    /* [v6]:port */
+    p++;
+    host_end = memchr(p, ']', end - p);
+    if(host_end == NULL) {
+      return 0;
+    }
+    if(host_end + 1 < end &&
+       (host_end[1] != ':' || !parse_port(host_end + 2, end, &b->port))) {
+      return 0;
+    }
+    end = host_end;
+  } else if((colon = memchr(p, ':', end - p)) != NULL &&
+            parse_ipv4(p, colon, v4)) {
+    /* a.b.c.d:port */
+    if(!parse_port(colon + 1, end, &b->port)) {
+      return 0;
+    }
+    end = colon;
+  }
+
+  if(parse_ipv4(p, end, v4)) {
+    len = snprintf(buf, sizeof(buf), "%s%02x%02x:%02x%02x", nat64,
+                   v4[0], v4[1], v4[2], v4[3]);
+    if(len < 0 || len >= (int)sizeof(buf)) {
+      return 0;
+    }
+    b->host = str_arena_strdup(buf);
+  } else {
+    if(p == end || end - p > BROKER_LIST_HOST_LEN) {
+      return 0;
+    }
+    b->host = str_arena_strndup(p, end - p);
+  }
+
+  return b->host != NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+healthy(const struct broker *b)
+{
+  return b->failures == 0 ||
+    clock_time() - b->failed_at >= BROKER_LIST_RETRY_AFTER;
+}
+/*---------------------------------------------------------------------------*/
+/* Fastest healthy broker other than skip, measured ones first */
+static int
+fastest(struct broker_list *l, int skip)
+{
+  int best = -1;
+  uint8_t i;
+
+  for(i = 0; i < l->count; i++) {
+    if(i == skip || !healthy(&l->entry[i])) {
+      continue;
+    }
+    if(best < 0 || (l->entry[i].rtt != 0 &&
+                    (l->entry[best].rtt == 0 ||
+                     l->entry[i].rtt < l->entry[best].rtt))) {
+      best = i;
+    }
+  }
+
+  return best;
+}
+/*---------------------------------------------------------------------------*/
+int
+broker_list_parse(struct broker_list *l, const char *spec, uint16_t port,
+                  const char *nat64)
+{
+  const char *end;
+
+  memset(l, 0, sizeof(*l));
+
+  while(*spec != '\0') {
+    end = strchr(spec, ',');
+    if(end == NULL) {
+      end = spec + strlen(spec);
+    }
+    if(l->count == BROKER_LIST_MAX ||
+       !parse_entry(&l->entry[l->count], spec, end, port, nat64)) {
+      return 0;
+    }
+    l->count++;
+    spec = *end == ',' ? end + 1 : end;
+  }
+
+  return l->count;
+}
+/*---------------------------------------------------------------------------*/
+struct broker *
+broker_list_current(struct broker_list *l)
+{
+  return &l->entry[l->current];
+}
+/*---------------------------------------------------------------------------*/
+int
+broker_list_find(struct broker_list *l, const char *host)
+{
+  uint8_t i;
+
+  for(i = 0; i < l->count; i++) {
+    if(strcmp(l->entry[i].host, host) == 0) {
+      l->current = i;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+broker_list_connected(struct broker_list *l, clock_time_t rtt)
+{
+  struct broker *b = &l->entry[l->current];
+  uint32_t ms = (uint32_t)rtt * 1000 / CLOCK_SECOND;
+  int best;
+  uint8_t i;
+
+  ms = MIN(MAX(ms, 1), 0xFFFF);
+  b->rtt = b->rtt == 0 ? ms : (3 * (uint32_t)b->rtt + ms) / 4;
+  b->failures = 0;
+
+  /* Measure every broker once */
+  for(i = 0; i < l->count; i++) {
+    if(l->entry[i].rtt == 0 && healthy(&l->entry[i])) {
+      l->current = i;
+      return 1;
+    }
+  }
+
+  best = fastest(l, l->current);
+  if(best >= 0 && FASTER(l->entry[best].rtt, b->rtt)) {
+    l->current = best;
+    return 1;
+  }
+
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+broker_list_failed(struct broker_list *l)
+{
+  struct broker *b = &l->entry[l->current];
+  int next;
+  uint8_t i;
+
+  if(b->failures < 0xFF) {
+    b->failures++;
+  }
+  b->failed_at = clock_time();
+
+  next = fastest(l, l->current);
+  if(next >= 0) {
+    l->current = next;
+    return 1;
+  }
+
+  /* All down: go round the list, the one that failed longest ago first */
+  for(i = 0; i < l->count; i++) {
+    if(clock_time() - l->entry[i].failed_at >
+       clock_time() - l->entry[l->current].failed_at) {
+      l->current = i;
+    }
+  }
+
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,98 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Ordered list of MQTT brokers with failover.
+ *
+ *     The list is given as a string of comma-separated entries, in order of
+ *     preference:
+ *
+ *         fd00::1/64              IPv6 address, default port
+ *         [fd00::1]:1884          IPv6 address and port
+ *         52.207.176.25           IPv4 address, default port
+ *         52.207.176.25:8883      IPv4 address and port
+ *
+ *     IPv4 addresses are turned into IPv6 ones behind the NAT64 prefix of
+ *     the border router, e.g. "fd00::ffff:" gives "fd00::ffff:34cf:b019".
+ *
+ *     Each successful connection measures the time from the connect to
+ *     CONNACK. Brokers that failed are left alone for
+ *     BROKER_LIST_RETRY_AFTER; among the others the one with the shortest
+ *     connect time wins, and those not measured yet are tried first.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef BROKER_LIST_H_
+#define BROKER_LIST_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "sys/clock.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+#ifdef BROKER_LIST_CONF_MAX
+#define BROKER_LIST_MAX BROKER_LIST_CONF_MAX
+#else
+#define BROKER_LIST_MAX 4
+#endif
+
+/* How long a broker that failed is skipped */
+#ifdef BROKER_LIST_CONF_RETRY_AFTER
+#define BROKER_LIST_RETRY_AFTER BROKER_LIST_CONF_RETRY_AFTER
+#else
+#define BROKER_LIST_RETRY_AFTER (5 * 60 * CLOCK_SECOND)
+#endif
+
+/* Longest address, without brackets or port, e.g. a full IPv6 one and /64 */
+#define BROKER_LIST_HOST_LEN 44
+/*---------------------------------------------------------------------------*/
+struct broker {
+  char *host;              /* In the string arena */
+  uint16_t port;
+  uint16_t rtt;            /* Connect to CONNACK, in ms. 0: not measured */
+  uint8_t failures;        /* In a row */
+  clock_time_t failed_at;
+};
+
+struct broker_list {
+  struct broker entry[BROKER_LIST_MAX];
+  uint8_t count;
+  uint8_t current;
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Build the list from its string form
+ * \param spec  Comma-separated entries, see above
+ * \param port  Port of the entries that have none
+ * \param nat64 NAT64 prefix, ending in ':'
+ * \return Number of entries, 0 if one of them is malformed or the string
+ *         arena is full
+ */
+int broker_list_parse(struct broker_list *l, const char *spec, uint16_t port,
+                      const char *nat64);
+
+/**
+ * \brief Broker to connect to next
+ */
+struct broker *broker_list_current(struct broker_list *l);
+
+/**
+ * \brief Make the entry for host current, e.g. the one saved before a reboot
+ * \return 0 if no entry has that address
+ */
+int broker_list_find(struct broker_list *l, const char *host);
+
+/**
+ * \brief The current broker answered: record how long it took
+ * \return 1 if another broker should be tried now, because it was never
+ *         measured or it answers clearly faster. It is then current
+ */
+int broker_list_connected(struct broker_list *l, clock_time_t rtt);
+
+/**
+ * \brief Connecting to the current broker failed: move to the next one
+ * \return 1 if a broker that has not failed recently is now current, 0 if
+ *         they all have and the caller should back off
+ */
+int broker_list_failed(struct broker_list *l);
+/*---------------------------------------------------------------------------*/
+#endif /* BROKER_LIST_H_ */
+/*---------------------------------------------------------------------------*/
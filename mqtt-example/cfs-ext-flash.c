@@ -0,0 +1,263 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     CFS on the external SPI flash of the CC26xx LaunchPad, see
+ *     cfs-ext-flash.h
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "cfs-ext-flash.h"
+
+#if CONTIKI_TARGET_SRF06_CC26XX
+#include "cfs/cfs.h"
+#include "ext-flash.h"
+#include "persist.h"
+#include "spool.h"
+#include "sys/cc.h"
+
+#include <stdint.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define SECTORS(bytes) \
+  (((bytes) + CFS_EXT_FLASH_SECTOR - 1) / CFS_EXT_FLASH_SECTOR)
+
+#define PERSIST_OFFSET   CFS_EXT_FLASH_BASE
+#define PERSIST_REGION   CFS_EXT_FLASH_SECTOR
+#define SPOOL_OFFSET     (PERSIST_OFFSET + PERSIST_REGION)
+#define SPOOL_REGION     (SECTORS(SPOOL_MAX_SIZE) * CFS_EXT_FLASH_SECTOR)
+
+#define END_UNKNOWN      UINT32_MAX
+/*---------------------------------------------------------------------------*/
+struct file {
+  const char *name;
+  uint32_t offset;
+  uint32_t size;
+  uint32_t end;           /* First erased byte, END_UNKNOWN until looked up */
+};
+
+struct fd {
+  struct file *file;      /* NULL if the descriptor is free */
+  uint32_t pos;
+  uint8_t flags;
+};
+
+static struct file files[] = {
+  { PERSIST_FILE, PERSIST_OFFSET, PERSIST_REGION, END_UNKNOWN },
+  { SPOOL_FILE, SPOOL_OFFSET, SPOOL_REGION, END_UNKNOWN },
+};
+#define FILE_COUNT (sizeof(files) / sizeof(files[0]))
+
+static struct fd fds[CFS_EXT_FLASH_FDS];
+static uint8_t open_count;
+/*---------------------------------------------------------------------------*/
+static struct file *
+find(const char *name)
+{
+  uint8_t i;
+
+  for(i = 0; i < FILE_COUNT; i++) {
+    if(strcmp(files[i].name, name) == 0) {
+      return &files[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static struct fd *
+get_fd(int fd)
+{
+  if(fd < 0 || fd >= CFS_EXT_FLASH_FDS || fds[fd].file == NULL) {
+    return NULL;
+  }
+  return &fds[fd];
+}
+/*---------------------------------------------------------------------------*/
+/* The SPI flash is powered down whenever no file is open */
+static int
+flash_on(void)
+{
+  if(open_count == 0 && !ext_flash_open()) {
+    return 0;
+  }
+  open_count++;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+flash_off(void)
+{
+  if(--open_count == 0) {
+    ext_flash_close();
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Written bytes come first and erased ones after, so a binary search finds
+ * the end in a dozen one-byte reads. It is then kept up to date by writes
+ */
+static uint32_t
+file_end(struct file *f)
+{
+  uint32_t lo = 0;
+  uint32_t hi = f->size;
+  uint32_t mid;
+  uint8_t b;
+
+  if(f->end != END_UNKNOWN) {
+    return f->end;
+  }
+
+  while(lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if(!ext_flash_read(f->offset + mid, 1, &b)) {
+      /* Unknown: make it look full rather than write over anything */
+      return f->size;
+    }
+    if(b == 0xFF) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+
+  f->end = lo;
+  return f->end;
+}
+/*---------------------------------------------------------------------------*/
+static int
+erase(struct file *f)
+{
+  if(!ext_flash_erase(f->offset, f->size)) {
+    f->end = END_UNKNOWN;
+    return 0;
+  }
+  f->end = 0;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_open(const char *name, int flags)
+{
+  struct file *f = find(name);
+  int fd;
+
+  if(f == NULL) {
+    return -1;
+  }
+  for(fd = 0; fd < CFS_EXT_FLASH_FDS && fds[fd].file != NULL; fd++);
+  if(fd == CFS_EXT_FLASH_FDS || !flash_on()) {
+    return -1;
+  }
+
+  fds[fd].pos = 0;
+  if(flags & CFS_WRITE) {
+    if(flags & CFS_APPEND) {
+      fds[fd].pos = file_end(f);
+    } else if(!erase(f)) {
+      flash_off();
+      return -1;
+    }
+  }
+  fds[fd].file = f;
+  fds[fd].flags = flags;
+
+  return fd;
+}
+/*---------------------------------------------------------------------------*/
+void
+cfs_close(int fd)
+{
+  struct fd *d = get_fd(fd);
+
+  if(d != NULL) {
+    d->file = NULL;
+    flash_off();
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_read(int fd, void *buf, unsigned int len)
+{
+  struct fd *d = get_fd(fd);
+
+  if(d == NULL || !(d->flags & CFS_READ)) {
+    return -1;
+  }
+
+  len = MIN(len, d->file->size - d->pos);
+  if(len > 0 &&
+     !ext_flash_read(d->file->offset + d->pos, len, (uint8_t *)buf)) {
+    return -1;
+  }
+  d->pos += len;
+
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_write(int fd, const void *buf, unsigned int len)
+{
+  struct fd *d = get_fd(fd);
+
+  /* Flash bits only go from 1 to 0: never write over what is there */
+  if(d == NULL || !(d->flags & CFS_WRITE) || d->pos < file_end(d->file)) {
+    return -1;
+  }
+
+  len = MIN(len, d->file->size - d->pos);
+  if(len > 0 && !ext_flash_write(d->file->offset + d->pos, len,
+                                 (const uint8_t *)buf)) {
+    d->file->end = END_UNKNOWN;
+    return -1;
+  }
+  d->pos += len;
+  d->file->end = d->pos;
+
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+cfs_offset_t
+cfs_seek(int fd, cfs_offset_t offset, int whence)
+{
+  struct fd *d = get_fd(fd);
+  cfs_offset_t base;
+
+  if(d == NULL) {
+    return -1;
+  }
+
+  if(whence == CFS_SEEK_SET) {
+    base = 0;
+  } else if(whence == CFS_SEEK_CUR) {
+    base = d->pos;
+  } else if(whence == CFS_SEEK_END) {
+    base = file_end(d->file);
+  } else {
+    return -1;
+  }
+
+  if(base + offset < 0 || base + offset > (cfs_offset_t)d->file->size) {
+    return -1;
+  }
+  d->pos = base + offset;
+
+  return d->pos;
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_remove(const char *name)
+{
+  struct file *f = find(name);
+  int ok;
+
+  if(f == NULL || !flash_on()) {
+    return -1;
+  }
+  ok = erase(f);
+  flash_off();
+
+  return ok ? 0 : -1;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* CONTIKI_TARGET_SRF06_CC26XX */
+/*---------------------------------------------------------------------------*/
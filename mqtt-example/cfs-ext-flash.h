@@ -0,0 +1,45 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     CFS on the external SPI flash of the CC26xx LaunchPad.
+ *
+ *     The CC26xx port has no file system, so persist.c and spool.c get the
+ *     few CFS calls they make from here. Each file has a fixed region of
+ *     whole 4 KB sectors, from CFS_EXT_FLASH_BASE on:
+ *
+ *         PERSIST_FILE    one sector
+ *         SPOOL_FILE      SPOOL_MAX_SIZE, rounded up to whole sectors
+ *
+ *     Opening a file for CFS_WRITE erases its region, unless CFS_APPEND is
+ *     given too. Flash reads back 0xFF where nothing was written, so the
+ *     end of a file, for CFS_APPEND and CFS_SEEK_END, is its first 0xFF
+ *     byte: right for the text rows of the spool, and persist.c never asks,
+ *     it rewrites its record whole and checks it by length and CRC. Reads
+ *     may go up to the end of the region.
+ *
+ *     Other targets use the file system of their own port.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef CFS_EXT_FLASH_H_
+#define CFS_EXT_FLASH_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+/*---------------------------------------------------------------------------*/
+/* Offset of the first file in the external flash */
+#ifdef CFS_EXT_FLASH_CONF_BASE
+#define CFS_EXT_FLASH_BASE CFS_EXT_FLASH_CONF_BASE
+#else
+#define CFS_EXT_FLASH_BASE 0
+#endif
+
+#define CFS_EXT_FLASH_SECTOR 4096
+
+/* Files open at the same time */
+#ifdef CFS_EXT_FLASH_CONF_FDS
+#define CFS_EXT_FLASH_FDS CFS_EXT_FLASH_CONF_FDS
+#else
+#define CFS_EXT_FLASH_FDS 2
+#endif
+/*---------------------------------------------------------------------------*/
+#endif /* CFS_EXT_FLASH_H_ */
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,203 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Routing of channel-tagged UART lines, see channel-table.h
+ *
+ *     The channels are kept in the order they were created, and found
+ *     through an open-addressing index of twice as many slots, so a lookup
+ *     is one hash and, nearly always, one string compare.
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "channel-table.h"
+
+#include <stdint.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define SLOTS            (2 * CHANNEL_TABLE_MAX)
+#define FREE_SLOT        0xFF
+
+#define IS_DIGIT(c)      ((uint8_t)((c) - '0') < 10)
+#define IS_ALPHA(c)      ((uint8_t)(((c) | 0x20) - 'a') < 26)
+#define IS_ID_CHAR(c)    (IS_ALPHA(c) || IS_DIGIT(c) || (c) == '_')
+
+#if CHANNEL_TABLE_MAX >= FREE_SLOT
+#error "CHANNEL_TABLE_MAX must be less than 255"
+#endif
+/*---------------------------------------------------------------------------*/
+static struct channel channels[CHANNEL_TABLE_MAX];
+static uint8_t rings[CHANNEL_TABLE_MAX][CHANNEL_TABLE_BATCH];
+static uint8_t slots[SLOTS];
+static uint8_t used;
+static uint16_t unrouted;
+
+static clock_time_t default_max_age;
+static uint8_t default_max_lines;
+/*---------------------------------------------------------------------------*/
+/* FNV-1a */
+static uint16_t
+hash(const char *id, uint8_t len)
+{
+  uint16_t h = 0x811C;
+
+  while(len--) {
+    h = (h ^ (uint8_t)*id++) * 0x0193;
+  }
+  return h;
+}
+/*---------------------------------------------------------------------------*/
+/* A batch is due when its oldest line is too old or it holds enough lines */
+static int
+is_due(const struct channel *c, clock_time_t now)
+{
+  return c->batch.lines > 0 &&
+    (now - c->oldest >= c->max_age ||
+     (c->max_lines > 0 && c->batch.lines >= c->max_lines) ||
+     /* Publish before the batch overflows */
+     c->batch.fill * 4 >= c->batch.size * 3);
+}
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+overdue(const struct channel *c, clock_time_t now)
+{
+  return now - c->oldest > c->max_age ? now - c->oldest - c->max_age : 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+channel_table_init(clock_time_t max_age, uint8_t max_lines)
+{
+  memset(channels, 0, sizeof(channels));
+  memset(slots, FREE_SLOT, sizeof(slots));
+  used = 0;
+  unrouted = 0;
+  default_max_age = max_age;
+  default_max_lines = max_lines;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+channel_tag_len(const char *line, uint8_t len)
+{
+  uint8_t i;
+
+  for(i = 0; i < len && i <= CHANNEL_ID_LEN && IS_ID_CHAR(line[i]); i++);
+
+  return i > 0 && i < len && i <= CHANNEL_ID_LEN && line[i] == ':' ? i + 1 : 0;
+}
+/*---------------------------------------------------------------------------*/
+struct channel *
+channel_table_get(const char *id, uint8_t id_len)
+{
+  struct channel *c;
+  uint8_t slot;
+  uint8_t n;
+
+  if(id_len > CHANNEL_ID_LEN) {
+    return NULL;
+  }
+
+  slot = hash(id, id_len) % SLOTS;
+  for(n = 0; n < SLOTS; n++) {
+    if(slots[slot] == FREE_SLOT) {
+      break;
+    }
+    c = &channels[slots[slot]];
+    if(memcmp(c->id, id, id_len) == 0 && c->id[id_len] == '\0') {
+      return c;
+    }
+    slot = (slot + 1) % SLOTS;
+  }
+
+  /* New channel. The index is never more than half full */
+  if(used == CHANNEL_TABLE_MAX) {
+    unrouted++;
+    return NULL;
+  }
+
+  c = &channels[used];
+  memcpy(c->id, id, id_len);
+  c->id[id_len] = '\0';
+  c->batch.ring = rings[used];
+  c->batch.size = CHANNEL_TABLE_BATCH;
+  c->max_age = default_max_age;
+  c->max_lines = default_max_lines;
+  slots[slot] = used++;
+
+  return c;
+}
+/*---------------------------------------------------------------------------*/
+int
+channel_table_put(struct channel *c, const char *line, uint8_t len,
+                  clock_time_t now)
+{
+  if(c->batch.lines == 0) {
+    c->oldest = now;
+  }
+  if(!pub_queue_put(&c->batch, line, len)) {
+    return 0;
+  }
+  c->lines++;
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+struct channel *
+channel_table_due(clock_time_t now)
+{
+  struct channel *due = NULL;
+  uint8_t i;
+
+  for(i = 0; i < used; i++) {
+    if(is_due(&channels[i], now) &&
+       (due == NULL || overdue(&channels[i], now) > overdue(due, now))) {
+      due = &channels[i];
+    }
+  }
+
+  return due;
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+channel_table_next_due(clock_time_t now)
+{
+  clock_time_t next = (clock_time_t)-1;
+  clock_time_t age;
+  uint8_t i;
+
+  for(i = 0; i < used; i++) {
+    if(channels[i].batch.lines == 0) {
+      continue;
+    }
+    if(is_due(&channels[i], now)) {
+      return 0;
+    }
+    age = now - channels[i].oldest;
+    if(channels[i].max_age - age < next) {
+      next = channels[i].max_age - age;
+    }
+  }
+
+  return next;
+}
+/*---------------------------------------------------------------------------*/
+void
+channel_table_published(struct channel *c, clock_time_t now)
+{
+  c->published++;
+  c->latency_sum += now - c->oldest;
+  if(now - c->oldest > c->latency_max) {
+    c->latency_max = now - c->oldest;
+  }
+}
+/*---------------------------------------------------------------------------*/
+struct channel *
+channel_table_at(uint8_t i)
+{
+  return i < used ? &channels[i] : NULL;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+channel_table_unrouted(void)
+{
+  return unrouted;
+}
+/*---------------------------------------------------------------------------*/
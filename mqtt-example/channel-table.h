@@ -0,0 +1,113 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Routing of channel-tagged UART lines.
+ *
+ *     Several sensors can share the serial link by tagging their lines with
+ *     a channel ID: "<id>:<line>", e.g. "gas:CO=4.20,LPG=14.48" or
+ *     "3:21.5,60". Each channel gets its own batch of lines, published to a
+ *     topic of its own, and its own policy: the batch goes out once it holds
+ *     max_lines lines or its oldest line is max_age old, whichever comes
+ *     first.
+ *
+ *     Channels are created as their first line arrives, in a table of
+ *     CHANNEL_TABLE_MAX entries found by a hash of the ID. Nothing is ever
+ *     removed. All times are passed in by the caller, so the table can be
+ *     driven by a simulated clock.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef CHANNEL_TABLE_H_
+#define CHANNEL_TABLE_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "sys/clock.h"
+#include "pub-queue.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+#ifdef CHANNEL_TABLE_CONF_MAX
+#define CHANNEL_TABLE_MAX CHANNEL_TABLE_CONF_MAX
+#else
+#define CHANNEL_TABLE_MAX 8
+#endif
+
+/*
+ * Bytes of batch per channel, length prefixes included. The default holds
+ * the longest serial line (127 bytes, see ROUTER_LINE_MAX) and its length
+ */
+#ifdef CHANNEL_TABLE_CONF_BATCH
+#define CHANNEL_TABLE_BATCH CHANNEL_TABLE_CONF_BATCH
+#else
+#define CHANNEL_TABLE_BATCH 128
+#endif
+
+#define CHANNEL_ID_LEN 7
+/*---------------------------------------------------------------------------*/
+struct channel {
+  char id[CHANNEL_ID_LEN + 1];
+  struct pub_queue batch;
+  clock_time_t oldest;       /* Arrival of the oldest line in the batch */
+  clock_time_t max_age;      /* 0: publish every line as soon as possible */
+  uint8_t max_lines;         /* 0: no limit but the size of the batch */
+  uint16_t lines;
+  uint16_t published;        /* Batches */
+  clock_time_t latency_sum;  /* Age of the oldest line of each batch */
+  clock_time_t latency_max;
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Empty the table and set the policy new channels start with
+ */
+void channel_table_init(clock_time_t max_age, uint8_t max_lines);
+
+/**
+ * \brief Length of the "<id>:" tag at the start of a line
+ * \return 0 if the line has no tag
+ */
+uint8_t channel_tag_len(const char *line, uint8_t len);
+
+/**
+ * \brief Channel with that ID, created if it is new
+ * \return NULL if it is new and the table is full
+ */
+struct channel *channel_table_get(const char *id, uint8_t id_len);
+
+/**
+ * \brief Add a line, without its tag, to the batch of a channel
+ * \return 0 if the batch was full and the line was dropped
+ */
+int channel_table_put(struct channel *c, const char *line, uint8_t len,
+                      clock_time_t now);
+
+/**
+ * \brief The channel whose batch is most overdue for publishing
+ * \return NULL if none is due yet
+ */
+struct channel *channel_table_due(clock_time_t now);
+
+/**
+ * \brief How long until the next batch is due: 0 if one is due now,
+ *        (clock_time_t)-1 if every batch is empty
+ */
+clock_time_t channel_table_next_due(clock_time_t now);
+
+/**
+ * \brief The batch of a channel was published, as far as it fitted
+ *
+ * Records how long its oldest line waited. Lines left over keep that
+ * arrival time, so they are due again right away.
+ */
+void channel_table_published(struct channel *c, clock_time_t now);
+
+/**
+ * \brief Channel by position, for stats. NULL past the last one
+ */
+struct channel *channel_table_at(uint8_t i);
+
+/**
+ * \brief Number of lines refused because the table was full
+ */
+uint16_t channel_table_unrouted(void);
+/*---------------------------------------------------------------------------*/
+#endif /* CHANNEL_TABLE_H_ */
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,118 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Per-field deadband filter, see deadband.h
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "deadband.h"
+#include "sensor-line.h"
+
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define FLAG_DELTA   0x01  /* delta was set for this field */
+#define FLAG_LAST    0x02  /* last holds the last value reported */
+
+struct db_field {
+  char key[SENSOR_LINE_KEY_LEN + 1];
+  int32_t delta;
+  int32_t last;
+  uint8_t flags;
+};
+
+static struct db_field fields[DEADBAND_FIELDS];
+static uint8_t used;
+static int32_t default_delta;
+static uint16_t suppressed;
+/*---------------------------------------------------------------------------*/
+static struct db_field *
+lookup(const char *key, uint8_t create)
+{
+  uint8_t i;
+
+  for(i = 0; i < used; i++) {
+    if(strcmp(fields[i].key, key) == 0) {
+      return &fields[i];
+    }
+  }
+
+  if(!create || used == DEADBAND_FIELDS ||
+     strlen(key) > SENSOR_LINE_KEY_LEN) {
+    return NULL;
+  }
+  strcpy(fields[used].key, key);
+  fields[used].flags = 0;
+  return &fields[used++];
+}
+/*---------------------------------------------------------------------------*/
+void
+deadband_set_default(int32_t delta)
+{
+  default_delta = delta;
+}
+/*---------------------------------------------------------------------------*/
+int
+deadband_set(const char *key, int32_t delta)
+{
+  struct db_field *f = lookup(key, 1);
+
+  if(f == NULL) {
+    return 0;
+  }
+  f->delta = delta;
+  f->flags |= FLAG_DELTA;
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int32_t
+deadband_delta(const char *key)
+{
+  struct db_field *f = lookup(key, 0);
+
+  return f != NULL && (f->flags & FLAG_DELTA) ? f->delta : default_delta;
+}
+/*---------------------------------------------------------------------------*/
+int
+deadband_pass(const char *key, int32_t value)
+{
+  struct db_field *f = lookup(key, 1);
+  int32_t delta;
+  uint32_t moved;
+
+  if(f == NULL) {
+    return 1;
+  }
+
+  delta = f->flags & FLAG_DELTA ? f->delta : default_delta;
+  if(f->flags & FLAG_LAST && delta > 0) {
+    moved = value >= f->last ? (uint32_t)value - f->last :
+      (uint32_t)f->last - value;
+    if(moved < (uint32_t)delta) {
+      suppressed++;
+      return 0;
+    }
+  }
+
+  f->last = value;
+  f->flags |= FLAG_LAST;
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+deadband_expire(void)
+{
+  uint8_t i;
+
+  for(i = 0; i < used; i++) {
+    fields[i].flags &= ~FLAG_LAST;
+  }
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+deadband_suppressed(void)
+{
+  return suppressed;
+}
+/*---------------------------------------------------------------------------*/
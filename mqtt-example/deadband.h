@@ -0,0 +1,61 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Report-by-exception filter for the sensor fields.
+ *
+ *     A field is reported only when its value has moved by at least its
+ *     deadband since the last value reported. The deadband of each field can
+ *     be set at run time; fields without one use the default. A deadband of
+ *     0 or less turns the filter off for that field.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef DEADBAND_H_
+#define DEADBAND_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+#ifdef DEADBAND_CONF_FIELDS
+#define DEADBAND_FIELDS DEADBAND_CONF_FIELDS
+#else
+#define DEADBAND_FIELDS 4
+#endif
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Deadband of the fields that have none of their own
+ */
+void deadband_set_default(int32_t delta);
+
+/**
+ * \brief Set the deadband of one field
+ * \return 0 if the table of fields is full
+ */
+int deadband_set(const char *key, int32_t delta);
+
+/**
+ * \brief Deadband that applies to a field
+ */
+int32_t deadband_delta(const char *key);
+
+/**
+ * \brief Check a new value of a field
+ * \return 1 if it should be reported; it then becomes the reference value
+ *
+ * The first value of a field, and every value once the table is full, is
+ * reported.
+ */
+int deadband_pass(const char *key, int32_t value);
+
+/**
+ * \brief Let the next value of every field through, e.g. for a heartbeat
+ */
+void deadband_expire(void);
+
+/**
+ * \brief Number of values held back so far
+ */
+uint16_t deadband_suppressed(void);
+/*---------------------------------------------------------------------------*/
+#endif /* DEADBAND_H_ */
+/*---------------------------------------------------------------------------*/
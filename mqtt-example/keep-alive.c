@@ -0,0 +1,164 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Adaptive MQTT keep-alive, see keep-alive.h
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "keep-alive.h"
+#include "sys/ctimer.h"
+#include "sys/cc.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+/* How long after a PINGREQ is due to look for it, and then for the answer */
+#define WATCH_DELAY CLOCK_SECOND
+/*---------------------------------------------------------------------------*/
+static struct mqtt_connection *conn;
+static uint16_t max_period;
+static uint16_t period;
+/* Period the current connection was made with */
+static uint16_t used;
+/* Just below the shortest idle stretch that has killed a connection */
+static uint16_t ceiling;
+static uint16_t pings;
+static uint8_t run;
+
+/*
+ * apps/mqtt tells the application nothing about pings, so this timer looks
+ * at two fields of its connection once each PINGREQ is due. It relies on
+ * this behaviour of apps/mqtt/mqtt.c (Contiki 3.0):
+ * - the PINGREQ path (keep_alive_callback() -> pingreq_pt()) sets
+ *   conn->keep_alive_timer again, so its start moves on each PINGREQ;
+ * - handle_pingresp() clears conn->waiting_for_pingresp;
+ * - keep_alive_callback() is the timer's only callback, so
+ *   ctimer_restart() in keep_alive_traffic() just defers the next PINGREQ.
+ * vtime/vt-mqtt.c mirrors this, and "make -C vtime check" fails if the
+ * PINGREQs counted here stop matching the ones it sent.
+ */
+static struct ctimer watch_timer;
+static clock_time_t armed;       /* keep_alive_timer start we last saw */
+static uint8_t unanswered;
+
+/* Last packet sent, and the silence before it */
+static clock_time_t last_sent;
+static clock_time_t last_gap;
+
+static void watch_callback(void *ptr);
+/*---------------------------------------------------------------------------*/
+static void
+watch(void)
+{
+  struct timer *t = &conn->keep_alive_timer.etimer.timer;
+
+  /* Polled until the PINGRESP; apps/mqtt gives up on it at the next ping */
+  ctimer_set(&watch_timer,
+             unanswered ? WATCH_DELAY : timer_remaining(t) + WATCH_DELAY,
+             watch_callback, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_pingreq(void)
+{
+  if(conn->keep_alive_timer.etimer.timer.start != armed) {
+    /* Rearmed by apps/mqtt, not by us: a PINGREQ went out */
+    armed = conn->keep_alive_timer.etimer.timer.start;
+    pings++;
+    unanswered = 1;
+    last_gap = clock_time() - last_sent;
+    last_sent = clock_time();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+watch_callback(void *ptr)
+{
+  check_pingreq();
+
+  if(unanswered && !conn->waiting_for_pingresp) {
+    unanswered = 0;
+    /* The link survived another idle period: try a longer one next time */
+    if(++run >= KEEP_ALIVE_GROW_AFTER && period < ceiling) {
+      run = 0;
+      period = MIN(ceiling, period + MAX(1, period / 8));
+    }
+  }
+  watch();
+}
+/*---------------------------------------------------------------------------*/
+void
+keep_alive_init(uint16_t max, uint16_t learnt)
+{
+  max_period = MAX(max, KEEP_ALIVE_MIN);
+  ceiling = max_period;
+  period = learnt >= KEEP_ALIVE_MIN && learnt <= max_period ?
+    learnt : max_period;
+}
+/*---------------------------------------------------------------------------*/
+void
+keep_alive_connected(struct mqtt_connection *c)
+{
+  conn = c;
+  used = period;
+  run = 0;
+  unanswered = 0;
+  armed = conn->keep_alive_timer.etimer.timer.start;
+  last_sent = clock_time();
+  last_gap = 0;
+  watch();
+}
+/*---------------------------------------------------------------------------*/
+void
+keep_alive_traffic(void)
+{
+  if(conn == NULL) {
+    return;
+  }
+  check_pingreq();
+  last_gap = clock_time() - last_sent;
+  last_sent = clock_time();
+  ctimer_restart(&conn->keep_alive_timer);
+  armed = conn->keep_alive_timer.etimer.timer.start;
+  watch();
+}
+/*---------------------------------------------------------------------------*/
+int
+keep_alive_disconnected(void)
+{
+  uint16_t idle;
+
+  if(conn == NULL) {
+    return 0;
+  }
+  /* A PINGREQ may have gone out since the last look */
+  check_pingreq();
+  ctimer_stop(&watch_timer);
+  conn = NULL;
+
+  /*
+   * A packet sent into a connection the NAT has forgotten is only reported
+   * once TCP gives up on it, so the silence before it counts too
+   */
+  idle = MAX(clock_time() - last_sent, last_gap) / CLOCK_SECOND;
+  if(idle * 2 < used) {
+    /* Died while busy: not a timeout we can avoid by pinging sooner */
+    return 0;
+  }
+
+  ceiling = MAX(KEEP_ALIVE_MIN, MIN(ceiling, idle * 7 / 8));
+  period = MAX(KEEP_ALIVE_MIN, MIN(used, idle) * 3 / 4);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+keep_alive_period(void)
+{
+  return period;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+keep_alive_pings(void)
+{
+  return pings;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,72 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Adaptive MQTT keep-alive.
+ *
+ *     The period is the keep-alive sent in CONNECT, so apps/mqtt pings at
+ *     it and the broker expects as much. It starts at an upper bound and may
+ *     have to be shorter, because a NAT or the border router can forget an
+ *     idle TCP connection much sooner. It is shortened when the connection
+ *     dies after an idle stretch and lengthened again, slowly, as PINGRESPs
+ *     keep coming back; either way the new period is used from the next
+ *     CONNECT on. Every packet we send restarts the period, so no PINGREQ
+ *     goes out while data is flowing.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef KEEP_ALIVE_H_
+#define KEEP_ALIVE_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "mqtt.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+/* Shortest period, in seconds, however often idle connections die */
+#ifdef KEEP_ALIVE_CONF_MIN
+#define KEEP_ALIVE_MIN KEEP_ALIVE_CONF_MIN
+#else
+#define KEEP_ALIVE_MIN 15
+#endif
+
+/* PINGRESPs in a row on one connection before the period is lengthened */
+#ifdef KEEP_ALIVE_CONF_GROW_AFTER
+#define KEEP_ALIVE_GROW_AFTER KEEP_ALIVE_CONF_GROW_AFTER
+#else
+#define KEEP_ALIVE_GROW_AFTER 4
+#endif
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Set the bounds, before the first connection
+ * \param max    Longest period, in seconds
+ * \param period Period learnt before, e.g. saved across a reboot; 0 for max
+ */
+void keep_alive_init(uint16_t max, uint16_t period);
+
+/**
+ * \brief The broker accepted the connection: watch its pings
+ */
+void keep_alive_connected(struct mqtt_connection *conn);
+
+/**
+ * \brief A packet went out on the connection; the next ping can wait
+ */
+void keep_alive_traffic(void);
+
+/**
+ * \brief The connection is gone
+ * \return 1 if the period was shortened because it died while idle
+ */
+int keep_alive_disconnected(void);
+
+/**
+ * \brief Period to pass to mqtt_connect(), in seconds
+ */
+uint16_t keep_alive_period(void);
+
+/**
+ * \brief Number of PINGREQs sent so far
+ */
+uint16_t keep_alive_pings(void);
+/*---------------------------------------------------------------------------*/
+#endif /* KEEP_ALIVE_H_ */
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,97 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Fixed-size latency histograms, see lat-hist.h
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "lat-hist.h"
+#include "sys/cc.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+static uint8_t
+bucket(uint32_t ms)
+{
+  uint8_t b = 0;
+
+  while(ms > 0 && b < LAT_HIST_BUCKETS - 1) {
+    ms >>= 1;
+    b++;
+  }
+  return b;
+}
+/*---------------------------------------------------------------------------*/
+void
+lat_hist_add(struct lat_hist *h, clock_time_t delay)
+{
+  uint32_t ms = (uint32_t)delay * 1000 / CLOCK_SECOND;
+  uint8_t b = bucket(ms);
+
+  if(h->count[b] < 0xFFFF) {
+    h->count[b]++;
+  }
+  if(ms > h->max) {
+    h->max = ms;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+total(const struct lat_hist *h)
+{
+  uint32_t n = 0;
+  uint8_t b;
+
+  for(b = 0; b < LAT_HIST_BUCKETS; b++) {
+    n += h->count[b];
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+lat_hist_percentile(const struct lat_hist *h, uint8_t pct)
+{
+  uint32_t rank = (total(h) * pct + 99) / 100;
+  uint32_t seen = 0;
+  uint8_t b;
+
+  for(b = 0; b < LAT_HIST_BUCKETS - 1; b++) {
+    seen += h->count[b];
+    if(rank > 0 && seen >= rank) {
+      return MIN(1UL << b, h->max);
+    }
+  }
+  return h->max;
+}
+/*---------------------------------------------------------------------------*/
+int
+lat_hist_format(const struct lat_hist *h, const char *name, char *buf,
+                uint16_t size)
+{
+  int last;
+  int len;
+  int b;
+
+  len = snprintf(buf, size, "k=%s,n=%lu,p50=%lu,p90=%lu,p99=%lu,max=%lu,b=",
+                 name, (unsigned long)total(h),
+                 (unsigned long)lat_hist_percentile(h, 50),
+                 (unsigned long)lat_hist_percentile(h, 90),
+                 (unsigned long)lat_hist_percentile(h, 99),
+                 (unsigned long)h->max);
+
+  for(last = LAT_HIST_BUCKETS - 1; last > 0 && h->count[last] == 0; last--);
+  for(b = 0; b <= last && len > 0 && len < size; b++) {
+    len += snprintf(buf + len, size - len, b ? ".%u" : "%u", h->count[b]);
+  }
+
+  return len > 0 && len < size ? len : 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+lat_hist_reset(struct lat_hist *h)
+{
+  memset(h, 0, sizeof(*h));
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,57 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Fixed-size latency histograms.
+ *
+ *     Bucket 0 counts delays under 1 ms and bucket b, from 1 on, delays of
+ *     2^(b-1) up to 2^b ms; the last bucket takes everything longer. Each
+ *     histogram is LAT_HIST_BUCKETS 16-bit counters, which stop at 65535,
+ *     plus the largest delay seen, so tails stay visible where a mean
+ *     would hide them.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef LAT_HIST_H_
+#define LAT_HIST_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "sys/clock.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+/* 20 buckets: the last one starts at 2^18 ms, about 4.4 minutes */
+#ifdef LAT_HIST_CONF_BUCKETS
+#define LAT_HIST_BUCKETS LAT_HIST_CONF_BUCKETS
+#else
+#define LAT_HIST_BUCKETS 20
+#endif
+/*---------------------------------------------------------------------------*/
+struct lat_hist {
+  uint16_t count[LAT_HIST_BUCKETS];
+  uint32_t max;                     /* ms */
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Count one delay
+ */
+void lat_hist_add(struct lat_hist *h, clock_time_t delay);
+
+/**
+ * \brief Delay that pct percent of the samples did not exceed
+ * \return The upper bound of its bucket in ms, never more than the max
+ */
+uint32_t lat_hist_percentile(const struct lat_hist *h, uint8_t pct);
+
+/**
+ * \brief One row for the publish queue, e.g.
+ *        "k=lat_pub,n=40,p50=64,p90=512,p99=2048,max=1730,b=0.0.0.2.30.8"
+ *
+ * b lists the buckets up to the last non-empty one, separated by dots
+ * \return Length of the row, 0 if it did not fit
+ */
+int lat_hist_format(const struct lat_hist *h, const char *name, char *buf,
+                    uint16_t size);
+
+void lat_hist_reset(struct lat_hist *h);
+/*---------------------------------------------------------------------------*/
+#endif /* LAT_HIST_H_ */
+/*---------------------------------------------------------------------------*/
@@ -1,29 +1,536 @@
-### Taken from https://pypi.python.org/pypi/paho-mqtt
-### Requires Paho-MQTT package, install by:
-### pip install paho-mqtt
+#!/usr/bin/env python3
+### Host-side ingestor for the mqtt-example nodes.
+###
+### Subscribes with a wildcard, decodes the node payloads (one reading per
+### row, "key=value,key=value" or plain CSV) and appends them in batches to
+### a columnar time-series file. Memory is bounded by --batch rows per
+### worker plus a bounded hand-off queue between the MQTT thread and the
+### writer. When the writer falls behind and the queue is full, messages
+### are dropped and counted rather than stalling the MQTT network loop
+### (which would miss its keep-alive); the nodes' sequence numbers then
+### show them as lost.
+###
+### Every payload starts with a "#<client_id>,<epoch>,<seq>" header row.
+### The sequence numbers of all workers are checked in the parent process,
+### which periodically reports received, lost, duplicated and reordered
+### messages per node.
+###
+### Nodes built with "make KEY=<hex>" start the row with '$' instead and
+### encrypt the rest with AES-CCM (payload-sec.h). With the same --key
+### those payloads are authenticated and decrypted; any that fail are
+### counted and dropped.
+###
+### Several workers share the load through an MQTT shared subscription
+### ($share/<group>/<topic>, mosquitto >= 1.6), one process and one output
+### file per worker. That only adds throughput with a free core per worker;
+### --bench shows the totals for 1, 2, 4... workers on this host.
+###
+###   mqtt-client.py --broker fd00::1 --topic 'teste/#' --workers 4
+###   mqtt-client.py --key 000102030405060708090a0b0c0d0e0f
+###   mqtt-client.py --dump ingest-0.tsb
+###   mqtt-client.py --bench --workers 4
+###
+### Requires the Paho-MQTT package (pip install paho-mqtt) to subscribe;
+### --dump and --bench don't. --key needs the cryptography package.
 
-import paho.mqtt.client as mqtt
+import argparse
+import array
+import collections
+import math
+import multiprocessing
+import os
+import queue
+import struct
+import sys
+import threading
+import time
 
-# Change accordingly to the MQTT Broker and topic you want to subscribe
-# In the example it would be either "test.mosquitto.org" or "fd00::1" if
-# running a mosquitto broker locally
-MQTT_URL         = "fd00::1"
-MQTT_TOPIC_EVENT = "home/multi-gas-sensor"
+MQTT_URL = "fd00::1"
+MQTT_TOPIC = "teste/#"
+MQTT_SHARE_GROUP = "ingest"
 
+BLOCK_MAGIC = b"TSB1"
+COL_TIME = b"t"
+COL_FLOAT = b"f"
+COL_STRING = b"s"
 
-def on_connect(client, userdata, flags, rc):
-    print("Connected with result code " + str(rc))
-    client.subscribe(MQTT_TOPIC_EVENT)
-    print("Subscribed to " + MQTT_TOPIC_EVENT)
+NAN = float("nan")
 
-# The callback for when a PUBLISH message is received from the server.
-def on_message(client, userdata, msg):
-    print(msg.topic + " " + str(msg.payload))
+# payload-sec.h
+SEC_MIC_LEN = 8
+SEC_NONCE_LEN = 13
 
-client = mqtt.Client()
-client.on_connect = on_connect
-client.on_message = on_message
 
-print("connecting to " + MQTT_URL)
-client.connect(MQTT_URL, 1883, 60)
-client.loop_forever()
+# ---------------------------------------------------------------------------
+# Payload decoding
+def decode_payload(payload):
+    """Returns (header, rows) for a node payload.
+
+    header is (client_id, epoch, seq) from the "#client_id,epoch,seq" row,
+    or None. rows is a list of {field: value} dicts, one per reading. Rows
+    are "key=value" pairs separated by commas; a row without any '=' is
+    taken as CSV and its fields are named f0, f1, ... Values that parse as
+    numbers become floats, anything else is kept as a string.
+    """
+    header = None
+    rows = []
+    for line in payload.decode("ascii", "replace").splitlines():
+        line = line.strip()
+        if not line:
+            continue
+        if line[0] == "#":
+            try:
+                client, epoch, seq = line[1:].split(",")
+                header = (client, int(epoch, 16), int(seq))
+            except ValueError:
+                pass
+            continue
+        row = {}
+        for i, tok in enumerate(line.split(",")):
+            key, sep, val = tok.partition("=")
+            if not sep:
+                key, val = "f%d" % i, tok
+            key = key.strip()
+            val = val.strip()
+            try:
+                row[key] = float(val)
+            except ValueError:
+                row[key] = val
+        rows.append(row)
+    return header, rows
+
+
+def make_aead(key):
+    """AES-CCM with the node's MIC length, for --key."""
+    from cryptography.hazmat.primitives.ciphers.aead import AESCCM
+    return AESCCM(bytes.fromhex(key), tag_length=SEC_MIC_LEN)
+
+
+def open_payload(payload, aead):
+    """Returns the payload in clear, or None if it can't be trusted.
+
+    A payload whose header row starts with '$' was sealed by the node: the
+    header row is authenticated, the rest is decrypted. The nonce is the
+    node id of the client id, the epoch (4 bytes) and the sequence number
+    (2 bytes), padded with zeros to 13 bytes. Clear payloads are returned as they are.
+    """
+    if payload[:1] != b"$":
+        return payload
+    if aead is None:
+        return None
+    header, sep, sealed = payload.partition(b"\n")
+    try:
+        client, epoch, seq = header[1:].decode("ascii").split(",")
+        nonce = (bytes.fromhex(client.partition(":")[2]) +
+                 int(epoch, 16).to_bytes(4, "big") +
+                 int(seq).to_bytes(2, "big")).ljust(SEC_NONCE_LEN, b"\0")
+        clear = aead.decrypt(nonce, sealed, header + sep)
+    except Exception:
+        return None
+    return b"#" + header[1:] + sep + clear
+
+
+# ---------------------------------------------------------------------------
+# Delivery accounting
+class SeqTracker(object):
+    """Gaps, duplicates and reordering per node, from the header rows.
+
+    Sequence numbers are 16 bits on the node and are unwrapped against the
+    highest one seen. Missing numbers are remembered for WINDOW messages so
+    a late arrival counts as reordered rather than lost; older gaps are
+    final. A new epoch (reboot) starts a fresh sequence.
+    """
+    WINDOW = 1024
+
+    class Node(object):
+        def __init__(self, epoch, seq):
+            self.epoch = epoch
+            self.high = seq
+            self.missing = collections.OrderedDict()
+            self.received = 1
+            self.lost = 0          # Gaps that fell out of the window
+            self.duplicates = 0
+            self.reordered = 0
+            self.epochs = 1
+
+    def __init__(self):
+        self.nodes = {}
+
+    def add(self, client, epoch, seq):
+        n = self.nodes.get(client)
+        if n is None:
+            self.nodes[client] = self.Node(epoch, seq)
+            return
+        if n.epoch != epoch:
+            n.lost += len(n.missing)
+            n.missing.clear()
+            n.epoch = epoch
+            n.high = seq
+            n.received += 1
+            n.epochs += 1
+            return
+
+        diff = (seq - n.high) & 0xFFFF
+        if 0 < diff < 0x8000:
+            for s in range(n.high + 1, n.high + diff):
+                n.missing[s] = True
+            while len(n.missing) > self.WINDOW:
+                n.missing.popitem(last=False)
+                n.lost += 1
+            n.high += diff
+            n.received += 1
+            return
+
+        seq = n.high - ((-diff) & 0xFFFF)
+        if n.missing.pop(seq, None):
+            n.reordered += 1
+            n.received += 1
+        else:
+            n.duplicates += 1
+
+    def report(self, out=sys.stdout):
+        out.write("%-18s %8s %7s %7s %7s %6s %7s\n" %
+                  ("client", "recv", "lost", "dup", "reord", "boots", "loss"))
+        for client in sorted(self.nodes):
+            n = self.nodes[client]
+            lost = n.lost + len(n.missing)
+            out.write("%-18s %8d %7d %7d %7d %6d %6.2f%%\n" %
+                      (client, n.received, lost, n.duplicates, n.reordered,
+                       n.epochs - 1,
+                       100.0 * lost / (lost + n.received)))
+        out.flush()
+
+
+# ---------------------------------------------------------------------------
+# Columnar block file
+class BlockWriter(object):
+    """Buffers rows and appends them to the file as columnar blocks.
+
+    Every block carries its own schema (the union of the fields seen in
+    it), so the file is append-only and readable up to the last complete
+    block even if the ingestor is killed.
+    """
+
+    def __init__(self, path, batch, flush_interval):
+        self.f = open(path, "ab")
+        self.batch = batch
+        self.flush_interval = flush_interval
+        self.last_flush = time.time()
+        self.rows = []
+        self.written = 0
+
+    def add(self, t_ns, source, row):
+        self.rows.append((t_ns, source, row))
+        if (len(self.rows) >= self.batch or
+                time.time() - self.last_flush >= self.flush_interval):
+            self.flush()
+
+    def flush(self):
+        self.last_flush = time.time()
+        if not self.rows:
+            return
+        rows = self.rows
+        self.rows = []
+
+        names = []
+        seen = set()
+        for _, _, row in rows:
+            for k in row:
+                if k not in seen:
+                    seen.add(k)
+                    names.append(k)
+
+        cols = [("t", COL_TIME, array.array("q", (r[0] for r in rows))),
+                ("source", COL_STRING, [r[1] for r in rows])]
+        for name in names:
+            vals = [r[2].get(name, NAN) for r in rows]
+            if all(isinstance(v, float) for v in vals):
+                cols.append((name, COL_FLOAT, array.array("d", vals)))
+            else:
+                cols.append((name, COL_STRING,
+                             ["" if isinstance(v, float) and math.isnan(v)
+                              else str(v) for v in vals]))
+
+        out = [BLOCK_MAGIC, struct.pack("<IH", len(rows), len(cols))]
+        for name, kind, vals in cols:
+            bname = name.encode()
+            out.append(kind + struct.pack("<H", len(bname)) + bname)
+            if kind == COL_STRING:
+                index = {}
+                codes = array.array("H", (index.setdefault(v, len(index))
+                                          for v in vals))
+                out.append(struct.pack("<H", len(index)))
+                for v in index:
+                    bv = v.encode()
+                    out.append(struct.pack("<H", len(bv)) + bv)
+                vals = codes
+            if sys.byteorder != "little":
+                vals = array.array(vals.typecode, vals)
+                vals.byteswap()
+            out.append(vals.tobytes())
+
+        self.f.write(b"".join(out))
+        self.f.flush()
+        self.written += len(rows)
+
+    def close(self):
+        self.flush()
+        self.f.close()
+
+
+def read_blocks(path):
+    """Yields one {column: list} dict per block"""
+    with open(path, "rb") as f:
+        data = f.read()
+    pos = 0
+    while pos + 10 <= len(data):
+        if data[pos:pos + 4] != BLOCK_MAGIC:
+            raise ValueError("%s: bad block at offset %d" % (path, pos))
+        nrows, ncols = struct.unpack_from("<IH", data, pos + 4)
+        pos += 10
+        block = {}
+        for _ in range(ncols):
+            kind = data[pos:pos + 1]
+            (nlen,) = struct.unpack_from("<H", data, pos + 1)
+            name = data[pos + 3:pos + 3 + nlen].decode()
+            pos += 3 + nlen
+            if kind == COL_STRING:
+                (ndict,) = struct.unpack_from("<H", data, pos)
+                pos += 2
+                words = []
+                for _ in range(ndict):
+                    (vlen,) = struct.unpack_from("<H", data, pos)
+                    words.append(data[pos + 2:pos + 2 + vlen].decode())
+                    pos += 2 + vlen
+                codes = array.array("H")
+                codes.frombytes(data[pos:pos + 2 * nrows])
+                pos += 2 * nrows
+                block[name] = [words[c] for c in codes]
+            else:
+                vals = array.array("q" if kind == COL_TIME else "d")
+                vals.frombytes(data[pos:pos + 8 * nrows])
+                pos += 8 * nrows
+                block[name] = list(vals)
+        yield block
+
+
+# ---------------------------------------------------------------------------
+# Ingestion
+def worker(index, args, seq_q):
+    import paho.mqtt.client as mqtt
+
+    aead = make_aead(args.key) if args.key else None
+    rejected = [0]
+    dropped = [0]
+    writer = BlockWriter(os.path.join(args.out, "ingest-%d.tsb" % index),
+                         args.batch, args.flush_interval)
+    handoff = queue.Queue(maxsize=args.queue)
+    topic = args.topic
+    if args.workers > 1:
+        topic = "$share/%s/%s" % (MQTT_SHARE_GROUP, args.topic)
+
+    def on_connect(client, userdata, flags, rc, *extra):
+        print("[%d] connected (%s), subscribing to %s" % (index, rc, topic))
+        client.subscribe(topic)
+
+    def on_message(client, userdata, msg):
+        # Runs on the network thread: never wait for the writer
+        try:
+            handoff.put_nowait((time.time_ns(), msg.topic, msg.payload))
+        except queue.Full:
+            dropped[0] += 1
+            if dropped[0] % 1000 == 1:
+                print("[%d] writer behind, %d messages dropped" %
+                      (index, dropped[0]))
+
+    def write_loop():
+        while True:
+            item = handoff.get()
+            if item is None:
+                break
+            t_ns, source, payload = item
+            payload = open_payload(payload, aead)
+            if payload is None:
+                rejected[0] += 1
+                continue
+            header, rows = decode_payload(payload)
+            if header is not None:
+                seq_q.put(header)
+                source = header[0]
+            for row in rows:
+                writer.add(t_ns, source, row)
+
+    try:
+        client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION1)
+    except AttributeError:
+        client = mqtt.Client()
+    client.on_connect = on_connect
+    client.on_message = on_message
+
+    thread = threading.Thread(target=write_loop)
+    thread.start()
+    client.connect(args.broker, args.port, 60)
+    try:
+        client.loop_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        handoff.put(None)
+        thread.join()
+        writer.close()
+        print("[%d] %d rows written, %d payloads failed authentication, "
+              "%d dropped with the queue full" %
+              (index, writer.written, rejected[0], dropped[0]))
+
+
+def run(args):
+    if not os.path.isdir(args.out):
+        os.makedirs(args.out)
+    seq_q = multiprocessing.Queue(maxsize=args.queue)
+    procs = [multiprocessing.Process(target=worker, args=(i, args, seq_q))
+             for i in range(args.workers)]
+    for p in procs:
+        p.start()
+
+    tracker = SeqTracker()
+    next_report = time.time() + args.report_interval
+    try:
+        while any(p.is_alive() for p in procs):
+            try:
+                tracker.add(*seq_q.get(timeout=1.0))
+            except queue.Empty:
+                pass
+            if time.time() >= next_report:
+                tracker.report()
+                next_report += args.report_interval
+    except KeyboardInterrupt:
+        pass
+    for p in procs:
+        p.join()
+    while not seq_q.empty():
+        tracker.add(*seq_q.get())
+    tracker.report()
+
+
+# ---------------------------------------------------------------------------
+# Benchmark: decode + columnar write path, without a broker
+def bench_worker(index, args, messages, barrier, result):
+    path = os.path.join(args.out, "bench-%d.tsb" % index)
+    # Always answer, so bench() never waits on a worker that died
+    try:
+        payload = b"#d:00124b000001,1a2b3c4d,7\n" + b"\n".join(
+            b"CO=421.83,LPG=1448.36,s=%d" % i
+            for i in range(args.bench_rows))
+        aead = None
+        if args.key:
+            # Sealed the way payload-sec.c does, so decryption is measured too
+            aead = make_aead(args.key)
+            header, sep, body = payload.partition(b"\n")
+            header = b"$" + header[1:] + sep
+            nonce = (bytes.fromhex("00124b000001") +
+                     bytes.fromhex("1a2b3c4d") +
+                     (7).to_bytes(2, "big")).ljust(SEC_NONCE_LEN, b"\0")
+            payload = header + aead.encrypt(nonce, body, header)
+        writer = BlockWriter(path, args.batch, args.flush_interval)
+        # Setup and process start-up stay outside the measured interval
+        barrier.wait()
+        t0 = time.time()
+        for _ in range(messages):
+            t_ns = time.time_ns()
+            clear = open_payload(payload, aead)
+            if clear is None:
+                raise ValueError("benchmark payload failed authentication")
+            header, rows = decode_payload(clear)
+            for row in rows:
+                writer.add(t_ns, header[0], row)
+        writer.close()
+        result.put((t0, time.time()))
+    except Exception as e:
+        # A worker failing during setup must not leave the others waiting
+        # on the barrier
+        barrier.abort()
+        result.put("worker %d: %s" % (index, e))
+        raise
+    finally:
+        if os.path.exists(path):
+            os.unlink(path)
+
+
+def bench(args):
+    if not os.path.isdir(args.out):
+        os.makedirs(args.out)
+    messages = args.bench_messages
+    print("%d messages per worker, %d rows each, batch %d, %d CPU(s)" %
+          (messages, args.bench_rows, args.batch, os.cpu_count() or 1))
+    n = 1
+    while n <= args.workers:
+        result = multiprocessing.Queue()
+        barrier = multiprocessing.Barrier(n)
+        procs = [multiprocessing.Process(target=bench_worker,
+                                         args=(i, args, messages, barrier,
+                                               result))
+                 for i in range(n)]
+        for p in procs:
+            p.start()
+        per = [result.get() for _ in procs]
+        for p in procs:
+            p.join()
+        failed = [r for r in per if isinstance(r, str)]
+        if failed:
+            sys.exit("bench failed: " + "; ".join(failed))
+        # All workers leave the barrier together; the wall time runs from
+        # the first of them to the last one to finish
+        wall = max(end for _, end in per) - min(start for start, _ in per)
+        slowest = max(end - start for start, end in per)
+        print("%2d worker(s): %9.0f msg/s total, %8.0f msg/s per worker" %
+              (n, n * messages / wall, messages / slowest))
+        n *= 2
+
+
+def dump(path):
+    total = 0
+    for block in read_blocks(path):
+        names = list(block)
+        for i in range(len(block["t"])):
+            print(" ".join("%s=%s" % (k, block[k][i]) for k in names))
+        total += len(block["t"])
+    print("%d rows" % total, file=sys.stderr)
+
+
+def main():
+    p = argparse.ArgumentParser(description="mqtt-example host ingestor")
+    p.add_argument("--broker", default=MQTT_URL)
+    p.add_argument("--port", type=int, default=1883)
+    p.add_argument("--topic", default=MQTT_TOPIC)
+    p.add_argument("--workers", type=int, default=1,
+                   help="processes sharing the subscription")
+    p.add_argument("--out", default=".", help="directory for ingest-N.tsb")
+    p.add_argument("--batch", type=int, default=4096,
+                   help="rows per columnar block")
+    p.add_argument("--flush-interval", type=float, default=5.0,
+                   help="seconds before a partial block is written")
+    p.add_argument("--queue", type=int, default=1024,
+                   help="messages buffered between MQTT and the writer; "
+                   "more are dropped")
+    p.add_argument("--report-interval", type=float, default=60.0,
+                   help="seconds between delivery reports")
+    p.add_argument("--key", metavar="HEX",
+                   help="AES-128 key of the nodes' payloads, 32 hex digits")
+    p.add_argument("--dump", metavar="FILE", help="print a .tsb file")
+    p.add_argument("--bench", action="store_true",
+                   help="measure decode+write throughput, 1..--workers")
+    p.add_argument("--bench-messages", type=int, default=50000)
+    p.add_argument("--bench-rows", type=int, default=4,
+                   help="readings per benchmark message")
+    args = p.parse_args()
+
+    if args.dump:
+        dump(args.dump)
+    elif args.bench:
+        bench(args)
+    else:
+        run(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -35,27 +35,39 @@
 #include "net/ip/uip.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "net/ipv6/sicslowpan.h"
+#include "net/ipv6/uip-ds6-route.h"
 #include "sys/etimer.h"
 #include "sys/ctimer.h"
+#include "sys/cc.h"
+#include "lib/random.h"
+#include "lib/crc16.h"
 #include "lib/sensors.h"
 #include "dev/leds.h"
 #include "contiki.h"
-#include "dev/serial-line.h"		     //Biblioteca para interface serial
 
 #include <stdio.h>		
 #include <string.h>
 
-#include "dev/cc26xx-uart.h"	     //Bibliotecas para utilizar UART no cc2650
-#include "net-uart.h"			
-#include "ti-lib.h"			
+#include "router.h"
+#include "net-uart.h"
+#include "spool.h"
+#include "stack-wm.h"
+#include "str-arena.h"
+#include "pub-queue.h"
+#include "pub-hdr.h"
+#include "sensor-line.h"
+#include "sensor-agg.h"
+#include "deadband.h"
+#include "persist.h"
+#include "keep-alive.h"
+#include "broker-list.h"
+#include "channel-table.h"
+#include "payload-sec.h"
+#include "lat-hist.h"
+#include "trace.h"
 
 //#define CC26XX_UART_CONF_BAUD_RATE	115200 //Definição do baud rate do UART0
 /*---------------------------------------------------------------------------*/
-/*
- * MQTT broker address
- */
-static const char *broker_ip = MQTT_DEMO_BROKER_IP_ADDR;
-/*---------------------------------------------------------------------------*/
 /*
  * A timeout used when waiting for something to happen (e.g. to connect or to
  * disconnect)
@@ -72,6 +84,8 @@ static const char *broker_ip = MQTT_DEMO_BROKER_IP_ADDR;
 /* Connections and reconnections */
 #define RETRY_FOREVER              0xFF
 #define RECONNECT_INTERVAL         (CLOCK_SECOND * 2)
+/* Moving to another broker of the list does not back off */
+#define FAILOVER_INTERVAL          (CLOCK_SECOND >> 2)
 
 /*
  * Number of times to try reconnecting to the broker.
@@ -81,6 +95,8 @@ static const char *broker_ip = MQTT_DEMO_BROKER_IP_ADDR;
 #define CONNECTION_STABLE_TIME     (CLOCK_SECOND * 5)
 /*---------------------------------------------------------------------------*/
 static struct timer connection_life;
+static struct timer stats_timer;
+static void print_stats(void);
 static uint8_t connect_attempt;
 /*---------------------------------------------------------------------------*/
 /* Various states */
@@ -97,40 +113,75 @@ static uint8_t is_it_ready = 0;
 #define STATE_CONFIG_ERROR         0xFE
 #define STATE_ERROR                0xFF
 /*---------------------------------------------------------------------------*/
-#define CONFIG_EVENT_TYPE_ID_LEN     32
-#define CONFIG_CMD_TYPE_LEN          8
-#define CONFIG_IP_ADDR_STR_LEN       64
+/*
+ * Alarm lines wait here, ahead of the PUB_QUEUE_SIZE queue of the others.
+ * Room for at least the longest line and its length byte
+ */
+#ifdef ALARM_QUEUE_CONF_SIZE
+#define ALARM_QUEUE_SIZE ALARM_QUEUE_CONF_SIZE
+#else
+#define ALARM_QUEUE_SIZE (ROUTER_LINE_MAX + 1)
+#endif
+#if ALARM_QUEUE_SIZE <= ROUTER_LINE_MAX || \
+    CHANNEL_TABLE_BATCH <= ROUTER_LINE_MAX
+#error "Alarm queue and channel batches must hold a line of ROUTER_LINE_MAX"
+#endif
+/*---------------------------------------------------------------------------*/
+/*
+ * The "APP - Stats" line goes out with a publish at most this often, to keep
+ * the UART off the publish path; "stats" on the subscribed topic prints it
+ * right away
+ */
+#ifdef STATS_CONF_INTERVAL
+#define STATS_INTERVAL STATS_CONF_INTERVAL
+#else
+#define STATS_INTERVAL             (300 * CLOCK_SECOND)
+#endif
+/*---------------------------------------------------------------------------*/
+/* "d:" followed by 6 bytes of the link-layer address in hex */
+#define CLIENT_ID_LEN                16
 /*---------------------------------------------------------------------------*/
 /* A timeout used when waiting to connect to a network */
 #define NET_CONNECT_PERIODIC        (CLOCK_SECOND >> 2)
 #define NO_NET_LED_DURATION         (NET_CONNECT_PERIODIC >> 1)
+/*
+ * Without an address we wait for RPL to add a default route rather than
+ * poll; this only catches a notification that came before the address did
+ */
+#define NET_CONNECT_FALLBACK        (CLOCK_SECOND)
 /*---------------------------------------------------------------------------*/
-//PROCESS_NAME(mqtt_demo_process);
-PROCESS_NAME(test_serial);
-AUTOSTART_PROCESSES(&test_serial);
-//AUTOSTART_PROCESSES(&mqtt_demo_process);
+PROCESS_NAME(mqtt_client_process);
+AUTOSTART_PROCESSES(&router_process, &mqtt_client_process);
 /*---------------------------------------------------------------------------*/
 /**
  * \brief Data structure declaration for the MQTT client configuration
  */
 typedef struct mqtt_client_config {
-  char event_type_id[CONFIG_EVENT_TYPE_ID_LEN];
-  char broker_ip[CONFIG_IP_ADDR_STR_LEN];
-  char cmd_type[CONFIG_CMD_TYPE_LEN];
+  char *event_type_id;
+  struct broker_list brokers;
+  char *cmd_type;
   clock_time_t pub_interval;
-  uint16_t broker_port;
+  int32_t deadband;
+  int32_t alarm_level;
+  char alarm_key[SENSOR_LINE_KEY_LEN + 1];  /* Empty: no alarms */
+  uint8_t heartbeat;
+  uint8_t aggregate;
 } mqtt_client_config_t;
 /*---------------------------------------------------------------------------*/
 
 /*
- * Buffers for Client ID and Topic.
- * Make sure they are large enough to hold the entire respective string
+ * Client ID, topics and credentials. They live in the string arena, at
+ * their actual length, after the strings of the configuration
  */
-static char client_id[BUFFER_SIZE];
-static char pub_topic[BUFFER_SIZE];
-static char sub_topic[BUFFER_SIZE];
-static char username[BUFFER_SIZE];
-static char password[BUFFER_SIZE];
+static char *client_id;
+static char *pub_topic;
+static char *sub_topic;
+static char *alarm_topic;   /* NULL: alarms go out on pub_topic */
+static char *username;
+static char *password;
+static str_arena_mark_t identity_mark;
+/* The link-layer address bytes of the client ID, also in the CCM nonce */
+static uint8_t node_id[PAYLOAD_SEC_ID_LEN];
 /*---------------------------------------------------------------------------*/
 /*
  * The main MQTT buffers.
@@ -139,16 +190,157 @@ static char password[BUFFER_SIZE];
 static struct mqtt_connection conn;
 static char app_buffer[APP_BUFFER_SIZE];	//This is the payload char array
 /*---------------------------------------------------------------------------*/
+static uint32_t pub_count;
+static uint32_t pub_bytes;
+/*---------------------------------------------------------------------------*/
+PUB_QUEUE(line_queue, PUB_QUEUE_SIZE);
+PUB_QUEUE(alarm_queue, ALARM_QUEUE_SIZE);
+/* Arrival of the oldest alarm not yet published, and the worst delay */
+static clock_time_t alarm_since;
+static clock_time_t alarm_worst;
+static uint16_t alarm_count;
+/* Arrival of the oldest line in line_queue */
+static clock_time_t line_since;
+
+/* After a line went into line_queue */
+static void
+line_queued(void)
+{
+  /* Lines left over from a publish keep the arrival of the oldest */
+  if(pub_queue_count(&line_queue) == 1) {
+    line_since = clock_time();
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Where the time goes, dumped by "lat" on the subscribed topic:
+ * - lat_uart: oldest line of a publish, from its arrival to mqtt_publish()
+ * - lat_pub: mqtt_publish() to the out buffer sent (QoS 0) or PUBACK
+ * - lat_recon: connection lost to publishing again
+ */
+static struct lat_hist hist_uart;
+static struct lat_hist hist_pub;
+static struct lat_hist hist_recon;
+/* The publish in flight, 0 if none, and the connection lost, 0 if up */
+static clock_time_t t_published;
+static mqtt_qos_level_t published_qos;
+static clock_time_t t_lost;
+/*---------------------------------------------------------------------------*/
+/*
+ * Tagged lines ("<id>:<line>") go to the batch of their channel, published
+ * to "<pub_topic>/<id>". One topic at a time is enough, since a publish
+ * only starts once the previous one has been sent
+ */
+static char channel_topic[PUB_HDR_MAX_TOPIC_LEN + 1];
+static struct etimer channel_timer;
+/*---------------------------------------------------------------------------*/
+/* Our end of the UART router */
+static int mqtt_input(const struct router_line *l);
+
+static struct sink mqtt_sink = { NULL, "mqtt", &mqtt_client_process,
+                                 mqtt_input, 0, 0, 0 };
+/*---------------------------------------------------------------------------*/
 static struct mqtt_message *msg_ptr = 0;
 static struct etimer publish_periodic_timer;
+/*
+ * conf.pub_interval long windows: the readings of a window are summarised at
+ * its end, and a heartbeat is due after conf.heartbeat quiet windows
+ */
+static struct etimer window_timer;
+static uint8_t quiet_windows;
+static uint8_t heartbeat_due;
 static struct ctimer ct;
-static char *buf_ptr;
+/*
+ * Every publish starts with a header row, "#<client_id>,<epoch>,<seq>", so
+ * the subscriber can tell lost messages from late ones. The epoch goes up
+ * by one, and is saved, every time the counter is reset, which tells a
+ * reboot apart from a wrap of the counter. It starts at random.
+ *
+ * With DEFAULT_PAYLOAD_SEC the row starts with '$' instead, the rest of the
+ * payload is encrypted and the pair is the CCM nonce, so the epoch also
+ * goes up when the counter wraps. It is 32 bits then, drawn whole on a
+ * cold boot, so one that lost its saved state is unlikely to draw an epoch
+ * it has used before, and nothing is sealed under an epoch until it has
+ * been saved: a reboot carries on from it instead of reusing it.
+ */
+#if DEFAULT_PAYLOAD_SEC
+/* payload_sec_start() loads its key into AES_128 once per session only */
+#if defined(LLSEC802154_CONF_ENABLED) && LLSEC802154_CONF_ENABLED
+#error "DEFAULT_PAYLOAD_SEC cannot share AES_128 with link-layer security"
+#endif
+#define PAYLOAD_MARK '$'
+#define EPOCH_FORMAT "%08lx"
+#else
+#define PAYLOAD_MARK '#'
+#define EPOCH_FORMAT "%04lx"
+#endif
 static uint16_t seq_nr_value = 0;
+static uint32_t boot_epoch;
+/* boot_epoch is in flash */
+static uint8_t epoch_saved;
 /*---------------------------------------------------------------------------*/
 static mqtt_client_config_t conf;
 /*---------------------------------------------------------------------------*/
-//PROCESS(mqtt_demo_process, "MQTT Demo");
-PROCESS(test_serial, "Test Serial");
+/*
+ * What survives a reboot: the configuration changed at run time, the broker,
+ * the sequence number epoch, what we know about the session and the
+ * keep-alive period learnt from the network. Bump
+ * SAVED_VERSION when the layout changes
+ */
+#define SAVED_VERSION               4
+#define SAVED_BROKER_IP_LEN         (BROKER_LIST_HOST_LEN + 1)
+
+#define SAVED_FLAG_CONNECTED        0x01  /* The broker took this config */
+#define SAVED_FLAG_SESSION          0x02  /* It holds our subscription */
+
+struct saved_state {
+  uint8_t version;
+  uint8_t flags;
+  uint16_t keep_alive;
+  uint32_t epoch;
+  uint16_t brokers_crc;                 /* Of DEFAULT_BROKERS */
+  uint16_t broker_rtt[BROKER_LIST_MAX];
+  uint8_t heartbeat;
+  uint8_t aggregate;
+  clock_time_t pub_interval;
+  int32_t deadband;
+  int32_t alarm_level;
+  char alarm_key[SENSOR_LINE_KEY_LEN + 1];
+  char broker_ip[SAVED_BROKER_IP_LEN];  /* The one the flags refer to */
+};
+
+static uint8_t saved_flags;
+static uint8_t state_dirty;
+static uint8_t warm_boot;
+/*---------------------------------------------------------------------------*/
+/* Bring-up milestones, in ticks since boot, for the first publish report */
+static clock_time_t boot_time;
+static clock_time_t t_net;
+static clock_time_t t_connack;
+static clock_time_t t_suback;
+static uint8_t first_publish_done;
+
+static struct uip_ds6_notification route_notification;
+static uint8_t waiting_for_net;
+/*---------------------------------------------------------------------------*/
+/*
+ * MQTT 3.1 has no "session present" flag in CONNACK, so whether the broker
+ * still has our subscription is tracked here (SAVED_FLAG_SESSION). Once per
+ * boot the subscription is renewed anyway, after the first publish, in case
+ * the broker lost it.
+ */
+static uint8_t session_checked;
+/* Broker that saved_flags refer to, index in conf.brokers */
+static uint8_t session_broker;
+/* Measured the broker, now on to the one broker_list_connected() chose */
+static uint8_t switching;
+static uint8_t resubscribe;
+/* Per connection: start of the attempt and CONNACK, for the ready report */
+static clock_time_t t_connect;
+static clock_time_t t_connected;
+static uint8_t ready_reported;
+/*---------------------------------------------------------------------------*/
+PROCESS(mqtt_client_process, "MQTT client");
 
 /*---------------------------------------------------------------------------*/
 int
@@ -157,7 +349,7 @@ ipaddr_sprintf(char *buf, uint8_t buf_len, const uip_ipaddr_t *addr)
   uint16_t a;
   uint8_t len = 0;
   int i, f;
-  for(i = 0, f = 0; i < sizeof(uip_ipaddr_t); i += 2) {
+  for(i = 0, f = 0; i < (int)sizeof(uip_ipaddr_t); i += 2) {
     a = (addr->u8[i] << 8) + addr->u8[i + 1];
     if(a == 0 && f >= 0) {
       if(f++ == 0) {
@@ -182,14 +374,226 @@ publish_led_off(void *d)
   leds_off(LEDS_GREEN);
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * "set db=1.00,CO=0.50,hb=10,agg=0": db is the default deadband, hb the
+ * heartbeat in publish intervals and agg turns aggregation on or off. Any
+ * other key sets the deadband of that field
+ */
+static void
+set_command(const char *args, uint16_t len)
+{
+  static struct sensor_record cmd;
+  struct sensor_field *f;
+  uint8_t i;
+  int rv;
+
+  rv = sensor_line_parse(args, len, &cmd);
+  if(rv != SENSOR_LINE_OK || !cmd.named) {
+    printf("APP - Bad set command (%d)\n", rv);
+    return;
+  }
+
+  for(i = 0; i < cmd.count; i++) {
+    f = &cmd.field[i];
+    if(f->value < 0) {
+      printf("APP - Negative %s ignored\n", f->key);
+    } else if(strcmp(f->key, "db") == 0) {
+      conf.deadband = f->value;
+      deadband_set_default(conf.deadband);
+    } else if(strcmp(f->key, "hb") == 0) {
+      conf.heartbeat = MIN(f->value / SENSOR_LINE_SCALE, 255);
+    } else if(strcmp(f->key, "agg") == 0) {
+      if(conf.aggregate != (f->value != 0)) {
+        sensor_agg_reset();
+      }
+      conf.aggregate = f->value != 0;
+    } else if(!deadband_set(f->key, f->value)) {
+      printf("APP - No room for the deadband of %s\n", f->key);
+    }
+  }
+
+  printf("APP - Config: deadband %ld, heartbeat %u, aggregate %u\n",
+         (long)conf.deadband, conf.heartbeat, conf.aggregate);
+  state_dirty = 1;
+}
+/*---------------------------------------------------------------------------*/
+/* "alarm CO=1000.00" sets the alarm rule, "alarm" alone clears it */
+static void
+alarm_command(const char *args, uint16_t len)
+{
+  static struct sensor_record cmd;
+  int rv;
+
+  if(len == 0) {
+    conf.alarm_key[0] = '\0';
+    printf("APP - Alarms off\n");
+    state_dirty = 1;
+    return;
+  }
+
+  rv = sensor_line_parse(args, len, &cmd);
+  if(rv != SENSOR_LINE_OK || !cmd.named || cmd.count != 1) {
+    printf("APP - Bad alarm command (%d)\n", rv);
+    return;
+  }
+
+  strcpy(conf.alarm_key, cmd.field[0].key);
+  conf.alarm_level = cmd.field[0].value;
+  printf("APP - Alarm when %s >= %ld\n", conf.alarm_key,
+         (long)conf.alarm_level);
+  state_dirty = 1;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * "chan gas age=5,n=4": publish the batch of channel gas when its oldest
+ * line is 5 s old or it holds 4 lines. age=0 publishes every line right away
+ */
+static void
+channel_command(const char *args, uint16_t len)
+{
+  static struct sensor_record cmd;
+  struct channel *c;
+  uint8_t id_len;
+  uint8_t i;
+  int rv;
+
+  for(id_len = 0; id_len < len && args[id_len] != ' '; id_len++);
+  c = id_len < len ? channel_table_get(args, id_len) : NULL;
+  if(c == NULL) {
+    printf("APP - Bad channel or channel table full\n");
+    return;
+  }
+
+  rv = sensor_line_parse(args + id_len + 1, len - id_len - 1, &cmd);
+  if(rv != SENSOR_LINE_OK || !cmd.named) {
+    printf("APP - Bad chan command (%d)\n", rv);
+    return;
+  }
+
+  for(i = 0; i < cmd.count; i++) {
+    if(cmd.field[i].value < 0) {
+      printf("APP - Negative %s ignored\n", cmd.field[i].key);
+    } else if(strcmp(cmd.field[i].key, "age") == 0) {
+      c->max_age = (uint32_t)cmd.field[i].value * CLOCK_SECOND /
+        SENSOR_LINE_SCALE;
+    } else if(strcmp(cmd.field[i].key, "n") == 0) {
+      c->max_lines = MIN(cmd.field[i].value / SENSOR_LINE_SCALE, 255);
+    }
+  }
+
+  printf("APP - Channel %s: age %lu ms, lines %u\n", c->id,
+         (unsigned long)(c->max_age * 1000 / CLOCK_SECOND), c->max_lines);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * "lat": queue one row per histogram for the next publish, "lat clear" also
+ * starts them over
+ */
+#define LAT_ROW_LEN (48 + 6 * LAT_HIST_BUCKETS)
+
+static void
+lat_command(const char *args, uint16_t len)
+{
+  static const struct {
+    const char *name;
+    struct lat_hist *h;
+  } hists[] = {
+    { "lat_uart", &hist_uart },
+    { "lat_pub", &hist_pub },
+    { "lat_recon", &hist_recon },
+  };
+  static char row[LAT_ROW_LEN];
+  uint8_t i;
+  int n;
+
+  for(i = 0; i < sizeof(hists) / sizeof(hists[0]); i++) {
+    n = lat_hist_format(hists[i].h, hists[i].name, row, sizeof(row));
+    printf("APP - %s\n", row);
+    if(n > 0 && pub_queue_put(&line_queue, row, MIN(n, 255))) {
+      line_queued();
+    }
+  }
+
+  if(len == 5 && memcmp(args, "clear", 5) == 0) {
+    lat_hist_reset(&hist_uart);
+    lat_hist_reset(&hist_pub);
+    lat_hist_reset(&hist_recon);
+  }
+  heartbeat_due = 1;
+  process_poll(&mqtt_client_process);
+}
+/*---------------------------------------------------------------------------*/
 static void
 pub_handler(const char *topic, uint16_t topic_len, const uint8_t *chunk,
             uint16_t chunk_len)
 {
-  printf("%s", chunk);
+  if(topic_len != strlen(sub_topic) ||
+     memcmp(topic, sub_topic, topic_len) != 0) {
+    return;
+  }
 
-}
+  if(chunk_len > 4 && memcmp(chunk, "set ", 4) == 0) {
+    set_command((const char *)chunk + 4, chunk_len - 4);
+    return;
+  }
+
+  if(chunk_len >= 5 && memcmp(chunk, "alarm", 5) == 0) {
+    alarm_command((const char *)chunk + MIN(chunk_len, 6),
+                  chunk_len - MIN(chunk_len, 6));
+    return;
+  }
+
+  if(chunk_len > 5 && memcmp(chunk, "chan ", 5) == 0) {
+    channel_command((const char *)chunk + 5, chunk_len - 5);
+    return;
+  }
 
+  if(chunk_len == 5 && memcmp(chunk, "stats", 5) == 0) {
+    print_stats();
+    return;
+  }
+
+  if(chunk_len >= 3 && memcmp(chunk, "lat", 3) == 0) {
+    lat_command((const char *)chunk + MIN(chunk_len, 4),
+                chunk_len - MIN(chunk_len, 4));
+    return;
+  }
+
+  printf("APP - Unknown command on %s\n", sub_topic);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+ticks_to_ms(clock_time_t t)
+{
+  return (unsigned long)t * 1000 / CLOCK_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+/* Ready to publish on this connection: subscribed, or the session resumed */
+static void
+connection_ready(const char *how)
+{
+  if(ready_reported) {
+    return;
+  }
+  ready_reported = 1;
+  printf("APP - Connected (%s): connack %lu, ready %lu ms\n", how,
+         ticks_to_ms(t_connected - t_connect),
+         ticks_to_ms(clock_time() - t_connect));
+  if(t_lost != 0) {
+    lat_hist_add(&hist_recon, clock_time() - t_lost);
+    t_lost = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The publish in flight got across: out buffer sent at QoS 0, PUBACK at 1 */
+static void
+published(mqtt_qos_level_t qos)
+{
+  if(t_published != 0 && published_qos == qos) {
+    lat_hist_add(&hist_pub, clock_time() - t_published);
+    t_published = 0;
+  }
+}
 /*---------------------------------------------------------------------------*/
 static void
 mqtt_event(struct mqtt_connection *m, mqtt_event_t event, void *data)
@@ -199,13 +603,41 @@ mqtt_event(struct mqtt_connection *m, mqtt_event_t event, void *data)
     printf("APP - Application has a MQTT connection\n");
     timer_set(&connection_life, CONNECTION_STABLE_TIME);
     state = STATE_CONNECTED;
+    keep_alive_connected(m);
+#if DEFAULT_PAYLOAD_SEC
+    /* Key schedule and nonce prefix, once per session */
+    payload_sec_start(node_id);
+#endif
+    if(t_connack == 0) {
+      t_connack = clock_time() - boot_time;
+    }
+    t_connected = clock_time();
+    printf("APP - Broker %s port %u: connack %lu ms\n",
+           broker_list_current(&conf.brokers)->host,
+           broker_list_current(&conf.brokers)->port,
+           ticks_to_ms(t_connected - t_connect));
+    switching = broker_list_connected(&conf.brokers, t_connected - t_connect);
+    saved_flags |= SAVED_FLAG_CONNECTED;
+    state_dirty = 1;
+    /* Subscribe now rather than on the next state machine tick */
+    process_poll(&mqtt_client_process);
     break;
   }
   case MQTT_EVENT_DISCONNECTED: {
     printf("APP - MQTT Disconnect. Reason %u\n", *((mqtt_event_t *)data));
+    if(keep_alive_disconnected()) {
+      printf("APP - Died while idle, keep-alive now %u s\n",
+             keep_alive_period());
+      state_dirty = 1;
+    }
+
+    if(t_lost == 0 && ready_reported) {
+      t_lost = clock_time();
+    }
+    t_published = 0;
 
     state = STATE_DISCONNECTED;
-    process_poll(&test_serial);
+    process_poll(&mqtt_client_process);
     break;
   }
   case MQTT_EVENT_PUBLISH: {
@@ -226,7 +658,15 @@ mqtt_event(struct mqtt_connection *m, mqtt_event_t event, void *data)
   case MQTT_EVENT_SUBACK: {
    	printf("APP - Application is subscribed to topic successfully\n");
 	is_it_ready = 1;
-	
+	if(t_suback == 0) {
+	  t_suback = clock_time() - boot_time;
+	}
+	if(DEFAULT_PERSISTENT_SESSION) {
+	  saved_flags |= SAVED_FLAG_SESSION;
+	  state_dirty = 1;
+	}
+	connection_ready("subscribed");
+	process_poll(&mqtt_client_process);
     break;
   }
   case MQTT_EVENT_UNSUBACK: {
@@ -235,6 +675,7 @@ mqtt_event(struct mqtt_connection *m, mqtt_event_t event, void *data)
   }
   case MQTT_EVENT_PUBACK: {
     printf("APP - Publishing complete.\n");
+    published(MQTT_QOS_LEVEL_1);
     break;
   }
   default:
@@ -243,28 +684,35 @@ mqtt_event(struct mqtt_connection *m, mqtt_event_t event, void *data)
   }
 }
 /*---------------------------------------------------------------------------*/
+static char *
+arena_string(const char *what, const char *str)
+{
+  char *copy = str_arena_strdup(str);
+
+  if(copy == NULL) {
+    printf("%s too large: %d, arena %u/%u\n", what, (int)strlen(str),
+           str_arena_used(), STR_ARENA_SIZE);
+  }
+
+  return copy;
+}
 /*---------------------------------------------------------------------------*/
 static int
 construct_username(void)
 {
-  int len = snprintf(username, BUFFER_SIZE, "");		
-	printf("%s\n", username);  
-	if(len < 0 || len >= BUFFER_SIZE) {
-    printf("Username too large: %d, Buffer %d\n", len, BUFFER_SIZE);
+  username = arena_string("Username", "");
+  if(username == NULL) {
     return 0;
   }
 
   return 1;
 }
 /*---------------------------------------------------------------------------*/
-/*---------------------------------------------------------------------------*/
 static int
 construct_password(void)
 {
-  int len = snprintf(password, BUFFER_SIZE, ""); 
-  printf("senha: %s\n", password);     
-  if(len < 0 || len >= BUFFER_SIZE) {
-    printf("password too large: %d, Buffer %d\n", len, BUFFER_SIZE);
+  password = arena_string("password", "");
+  if(password == NULL) {
     return 0;
   }
 
@@ -275,9 +723,8 @@ construct_password(void)
 static int
 construct_sub_topic(void)
 {
-  int len = snprintf(sub_topic, BUFFER_SIZE, "teste/sub");
-  if(len < 0 || len >= BUFFER_SIZE) {
-   	printf("Sub Topic too large: %d, Buffer %d\n", len, BUFFER_SIZE);
+  sub_topic = arena_string("Sub Topic", "teste/sub");
+  if(sub_topic == NULL) {
     return 0;
   }
 
@@ -289,13 +736,21 @@ construct_sub_topic(void)
 static int
 construct_pub_topic(void)
 {
-  int len = snprintf(pub_topic, BUFFER_SIZE, "teste/pub");
-  if(len < 0 || len >= BUFFER_SIZE) {
-    printf("Pub Topic too large: %d, Buffer %d\n", len, BUFFER_SIZE);
-    return 0;
+  pub_topic = arena_string("Pub Topic", "teste/pub");
+
+  return pub_topic != NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+construct_alarm_topic(void)
+{
+  if(DEFAULT_ALARM_TOPIC[0] == '\0') {
+    alarm_topic = NULL;
+    return 1;
   }
+  alarm_topic = arena_string("Alarm Topic", DEFAULT_ALARM_TOPIC);
 
-  return 1;
+  return alarm_topic != NULL;
 }
 
 
@@ -304,23 +759,36 @@ construct_pub_topic(void)
 static int
 construct_client_id(void)
 {
-  int len = snprintf(client_id, BUFFER_SIZE, "d:%02x%02x%02x%02x%02x%02x",
-                     linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
-                     linkaddr_node_addr.u8[2], linkaddr_node_addr.u8[5],
-                     linkaddr_node_addr.u8[6], linkaddr_node_addr.u8[7]);
-
-  /* len < 0: Error. Len >= BUFFER_SIZE: Buffer too small */
-  if(len < 0 || len >= BUFFER_SIZE) {
-    printf("Client ID: %d, Buffer %d\n", len, BUFFER_SIZE);
+  char buf[CLIENT_ID_LEN];
+  int len;
+
+  node_id[0] = linkaddr_node_addr.u8[0];
+  node_id[1] = linkaddr_node_addr.u8[1];
+  node_id[2] = linkaddr_node_addr.u8[2];
+  node_id[3] = linkaddr_node_addr.u8[5];
+  node_id[4] = linkaddr_node_addr.u8[6];
+  node_id[5] = linkaddr_node_addr.u8[7];
+  len = snprintf(buf, CLIENT_ID_LEN, "d:%02x%02x%02x%02x%02x%02x",
+                 node_id[0], node_id[1], node_id[2], node_id[3], node_id[4],
+                 node_id[5]);
+
+  /* len < 0: Error. Len >= CLIENT_ID_LEN: Buffer too small */
+  if(len < 0 || len >= CLIENT_ID_LEN) {
+    printf("Client ID: %d, Buffer %d\n", len, CLIENT_ID_LEN);
     return 0;
   }
 
-  return 1;
+  client_id = arena_string("Client ID", buf);
+
+  return client_id != NULL;
 }
 /*---------------------------------------------------------------------------*/
 static void
 update_config(void)
 {
+  /* Drop the strings built from the previous configuration */
+  str_arena_release(identity_mark);
+
   if(construct_client_id() == 0) {
     /* Fatal error. Client ID larger than the buffer */
     state = STATE_CONFIG_ERROR;
@@ -338,6 +806,11 @@ update_config(void)
     state = STATE_CONFIG_ERROR;
     return;
   }
+  if(construct_alarm_topic() == 0) {
+    /* Fatal error. Topic larger than the buffer */
+    state = STATE_CONFIG_ERROR;
+    return;
+  }
   if(construct_username() == 0) {
     /* Fatal error. Topic larger than the buffer */
     state = STATE_CONFIG_ERROR;
@@ -349,8 +822,15 @@ update_config(void)
     return;
   }
 
-  /* Reset the counter */
+  /*
+   * Reset the counter and start a new epoch, saved right away. The first
+   * publish announces it even if there is nothing to send yet
+   */
   seq_nr_value = 0;
+  boot_epoch++;
+  epoch_saved = 0;
+  state_dirty = 1;
+  heartbeat_due = 1;
 
   state = STATE_INIT;
 
@@ -365,28 +845,146 @@ update_config(void)
   return;
 }
 /*---------------------------------------------------------------------------*/
+/* Tells whether the saved connect times are for the same list of brokers */
+static uint16_t
+brokers_crc(void)
+{
+  return crc16_data((const unsigned char *)DEFAULT_BROKERS,
+                    sizeof(DEFAULT_BROKERS) - 1, 0);
+}
+/*---------------------------------------------------------------------------*/
 static int
 init_config()
 {
-  /* Populate configuration with default values */
+  struct saved_state saved;
+  uint8_t i;
+
+  /* Populate configuration with default values, or the saved ones */
   memset(&conf, 0, sizeof(mqtt_client_config_t));
-  memcpy(conf.event_type_id, DEFAULT_EVENT_TYPE_ID,
-         strlen(DEFAULT_EVENT_TYPE_ID));
-  memcpy(conf.broker_ip, broker_ip, strlen(broker_ip));
-  memcpy(conf.cmd_type, DEFAULT_SUBSCRIBE_CMD_TYPE, 4);
+  str_arena_reset();
+  warm_boot = persist_load(&saved, sizeof(saved)) &&
+    saved.version == SAVED_VERSION;
+  saved.broker_ip[SAVED_BROKER_IP_LEN - 1] = '\0';
+
+  conf.event_type_id = arena_string("Event type", DEFAULT_EVENT_TYPE_ID);
+  conf.cmd_type = arena_string("Command type", DEFAULT_SUBSCRIBE_CMD_TYPE);
+
+  if(conf.event_type_id == NULL || conf.cmd_type == NULL) {
+    return 0;
+  }
+
+#if DEFAULT_PAYLOAD_SEC
+  if(payload_sec_init(DEFAULT_PAYLOAD_KEY) == 0) {
+    printf("Bad payload key, need 32 hex digits\n");
+    return 0;
+  }
+#endif
+
+  if(broker_list_parse(&conf.brokers, DEFAULT_BROKERS, DEFAULT_BROKER_PORT,
+                       DEFAULT_NAT64_PREFIX) == 0) {
+    printf("Bad broker list or arena full: %s, arena %u/%u\n",
+           DEFAULT_BROKERS, str_arena_used(), STR_ARENA_SIZE);
+    return 0;
+  }
+
+  /* Everything after this point is rebuilt by update_config() */
+  identity_mark = str_arena_mark();
 
-  conf.broker_port = DEFAULT_BROKER_PORT;
   conf.pub_interval = DEFAULT_PUBLISH_INTERVAL;
+  conf.aggregate = DEFAULT_AGGREGATE;
+  conf.deadband = DEFAULT_DEADBAND;
+  conf.heartbeat = DEFAULT_HEARTBEAT;
+  strcpy(conf.alarm_key, DEFAULT_ALARM_KEY);
+  conf.alarm_level = DEFAULT_ALARM_LEVEL;
+#if DEFAULT_PAYLOAD_SEC
+  boot_epoch = (uint32_t)random_rand() << 16 | random_rand();
+#else
+  boot_epoch = random_rand();
+#endif
+
+  if(warm_boot) {
+    conf.pub_interval = saved.pub_interval;
+    conf.aggregate = saved.aggregate;
+    conf.deadband = saved.deadband;
+    conf.heartbeat = saved.heartbeat;
+    memcpy(conf.alarm_key, saved.alarm_key, sizeof(conf.alarm_key));
+    conf.alarm_key[SENSOR_LINE_KEY_LEN] = '\0';
+    conf.alarm_level = saved.alarm_level;
+    boot_epoch = saved.epoch;
+    saved_flags = saved.flags;
+    if(saved.brokers_crc == brokers_crc()) {
+      for(i = 0; i < conf.brokers.count; i++) {
+        conf.brokers.entry[i].rtt = saved.broker_rtt[i];
+      }
+    }
+    /* The session flags are only good for the broker they were saved for */
+    if(!broker_list_find(&conf.brokers, saved.broker_ip)) {
+      saved_flags &= ~SAVED_FLAG_SESSION;
+    }
+  }
+  session_broker = conf.brokers.current;
+  keep_alive_init(DEFAULT_KEEP_ALIVE_TIMER, warm_boot ? saved.keep_alive : 0);
+  deadband_set_default(conf.deadband);
+  channel_table_init(conf.pub_interval, 0);
+  printf("APP - %s boot, broker %s\n", warm_boot ? "Warm" : "Cold",
+         broker_list_current(&conf.brokers)->host);
 
   return 1;
 }
 /*---------------------------------------------------------------------------*/
 static void
+save_state(void)
+{
+  struct saved_state saved;
+  uint8_t i;
+
+  /* Zeroed so the padding, and with it the CRC, is reproducible */
+  memset(&saved, 0, sizeof(saved));
+  saved.version = SAVED_VERSION;
+  saved.flags = saved_flags;
+  saved.epoch = boot_epoch;
+  saved.keep_alive = keep_alive_period();
+  saved.brokers_crc = brokers_crc();
+  for(i = 0; i < conf.brokers.count; i++) {
+    saved.broker_rtt[i] = conf.brokers.entry[i].rtt;
+  }
+  saved.heartbeat = conf.heartbeat;
+  saved.aggregate = conf.aggregate;
+  saved.pub_interval = conf.pub_interval;
+  saved.deadband = conf.deadband;
+  saved.alarm_level = conf.alarm_level;
+  memcpy(saved.alarm_key, conf.alarm_key, sizeof(saved.alarm_key));
+  strncpy(saved.broker_ip, conf.brokers.entry[session_broker].host,
+          SAVED_BROKER_IP_LEN - 1);
+
+  state_dirty = 0;
+  if(!persist_save(&saved, sizeof(saved))) {
+    printf("APP - Could not save the state\n");
+    return;
+  }
+  epoch_saved = 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+route_changed(int event, uip_ipaddr_t *route, uip_ipaddr_t *nexthop,
+              int num_routes)
+{
+  /* Joined a DODAG: connect now instead of at the next fallback tick */
+  if(event == UIP_DS6_NOTIFICATION_DEFRT_ADD && waiting_for_net) {
+    process_poll(&mqtt_client_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
 subscribe(void)
 {
   /* Publish MQTT topic in IBM quickstart format */
   mqtt_status_t status;
-  status = mqtt_subscribe(&conn, NULL, sub_topic, MQTT_QOS_LEVEL_0);
+  /* QoS 1, so a persistent session queues commands while we are away */
+  status = mqtt_subscribe(&conn, NULL, sub_topic, MQTT_QOS_LEVEL_1);
+  if(status == MQTT_STATUS_OK) {
+    keep_alive_traffic();
+  }
 
  // printf("APP - Subscribing to %s\n", sub_topic);
   if(status == MQTT_STATUS_OUT_QUEUE_FULL) {
@@ -395,53 +993,338 @@ subscribe(void)
 }
 /*---------------------------------------------------------------------------*/
 static void
-publish(void)
-{ 	
-    
-  //uint16_t aux;
-  //int remaining = APP_BUFFER_SIZE;
-  buf_ptr = app_buffer;
-  //int len;
-  //process_start(&test_serial, "Test Serial");	
-  //process_poll(&test_serial);
- 	
-  printf("\nPublicando...\n");
-  /*
-  snprintf(buf_ptr, remaining, "{\"variable\": \"CO\",\"unit\" : \"ppm\",\"value\" : \"421.83\", \"variable\":\"LPG\",\"unit\":\"ppm\",\"value\":\"1448.36\" }");
-  */
-  //snprintf(buf_ptr, remaining, "hello from node, I'm working!");
-  /* Put our Default route's string representation in a buffer */
-  char def_rt_str[64];
-  memset(def_rt_str, 0, sizeof(def_rt_str));
-  ipaddr_sprintf(def_rt_str, sizeof(def_rt_str), uip_ds6_defrt_choose());
-
- 
-	
-  mqtt_publish(&conn, NULL, pub_topic, (uint8_t *)app_buffer,
-               strlen(app_buffer), MQTT_QOS_LEVEL_0, MQTT_RETAIN_OFF);		//Etapa de publicação
-  //keep_uart_on();
+print_stats(void)
+{
+  printf("APP - Stats: stack %u/%u, arena %u/%u, queue %u (dropped %u), "
+         "rejected %u, suppressed %u, pub %lu (%lu bytes), "
+         "keep-alive %u s (%u pings)\n",
+         stack_wm_max_used(), stack_wm_size(), str_arena_used(),
+         STR_ARENA_SIZE, pub_queue_count(&line_queue),
+         pub_queue_dropped(&line_queue),
+         router_rejected(), deadband_suppressed(), (unsigned long)pub_count,
+         (unsigned long)pub_bytes, keep_alive_period(), keep_alive_pings());
+  router_print_stats();
+  timer_set(&stats_timer, STATS_INTERVAL);
+}
+/*---------------------------------------------------------------------------*/
+static int
+publish_from(struct pub_queue *q, const char *topic, mqtt_qos_level_t qos,
+             clock_time_t since)
+{
+  uint16_t lines;
+  int hdr_len;
+  uint16_t room;
+  uint16_t len;
+
+#if DEFAULT_PAYLOAD_SEC
+  /* Not a single nonce under an epoch a reboot could hand out again */
+  if(!epoch_saved) {
+    save_state();
+    if(!epoch_saved) {
+      return 0;
+    }
+  }
+#endif
 
+  hdr_len = snprintf(app_buffer, APP_BUFFER_SIZE, "%c%s," EPOCH_FORMAT ",%u\n",
+                     PAYLOAD_MARK, client_id, (unsigned long)boot_epoch,
+                     seq_nr_value);
+  if(hdr_len < 0 || hdr_len + PAYLOAD_SEC_MIC_LEN >= APP_BUFFER_SIZE) {
+    return 0;
+  }
+  room = APP_BUFFER_SIZE - hdr_len;
+#if DEFAULT_PAYLOAD_SEC
+  /* Leave room for the MIC, and no more than CCM can take */
+  room = MIN(room - PAYLOAD_SEC_MIC_LEN, PAYLOAD_SEC_MAX_LEN + 1);
+#endif
+
+  /* As many queued lines as fit in the payload, one per row */
+  len = pub_queue_drain(q, app_buffer + hdr_len, room);
+  if(len == 0 && !heartbeat_due) {
+    return 0;
+  }
+  len += hdr_len;
+  /* Lines taken from q, not those it dropped as too long */
+  lines = q->drained_lines;
+#if DEFAULT_PAYLOAD_SEC
+  len = payload_sec_seal((uint8_t *)app_buffer, hdr_len, len, boot_epoch,
+                         seq_nr_value);
+#endif
+
+  if(mqtt_publish(&conn, NULL, (char *)topic, (uint8_t *)app_buffer,
+                  len, qos, MQTT_RETAIN_OFF) != MQTT_STATUS_OK) {	//Etapa de publicação
+    /* Not sent: the lines wait for the next attempt, under the same number */
+    pub_queue_undrain(q);
+    return 0;
+  }
+  /* The publish keeps the connection alive; no PINGREQ needed */
+  keep_alive_traffic();
+  t_published = clock_time();
+  published_qos = qos;
+#if DEFAULT_TRACE
+  trace_publish(topic, len, lines, qos);
+#endif
+  if(lines > 0) {
+    lat_hist_add(&hist_uart, clock_time() - since);
+  }
+  mqtt_sink.sent += lines;
+  seq_nr_value++;
+#if DEFAULT_PAYLOAD_SEC
+  /* A nonce must never come back: a new epoch, saved before the next one */
+  if(seq_nr_value == 0) {
+    boot_epoch++;
+    epoch_saved = 0;
+    state_dirty = 1;
+  }
+#endif
+  heartbeat_due = 0;
+  quiet_windows = 0;
+  pub_count++;
+  pub_bytes += pub_hdr_wire_len(strlen(topic), len, qos);
+
+  if(!first_publish_done) {
+    first_publish_done = 1;
+    printf("APP - Boot (%s): net %lu, connack %lu, suback %lu, "
+           "first publish %lu ms\n", warm_boot ? "warm" : "cold",
+           ticks_to_ms(t_net), ticks_to_ms(t_connack), ticks_to_ms(t_suback),
+           ticks_to_ms(clock_time() - boot_time));
+  }
   //printf("APP - Publish to %s: %s\n", pub_topic, app_buffer);
+
+  if(timer_expired(&stats_timer)) {
+    print_stats();
+  }
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+publish_channel(struct channel *c)
+{
+  snprintf(channel_topic, sizeof(channel_topic), "%s/%s", pub_topic, c->id);
+  if(!publish_from(&c->batch, channel_topic, MQTT_QOS_LEVEL_0, c->oldest)) {
+    return;
+  }
+
+  channel_table_published(c, clock_time());
+  printf("APP - Channel %s: lines %u, pub %u, dropped %u, "
+         "latency mean %lu, max %lu ms\n", c->id, c->lines, c->published,
+         pub_queue_dropped(&c->batch),
+         ticks_to_ms(c->latency_sum / c->published),
+         ticks_to_ms(c->latency_max));
+}
+/*---------------------------------------------------------------------------*/
+/* Pending alarms first, then channels that are due, then everything else */
+static void
+publish(void)
+{
+  struct channel *c;
+  clock_time_t delay;
+
+  if(pub_queue_count(&alarm_queue) > 0) {
+    if(!publish_from(&alarm_queue, alarm_topic, DEFAULT_ALARM_QOS,
+                     alarm_since)) {
+      return;
+    }
+    delay = clock_time() - alarm_since;
+    alarm_worst = MAX(alarm_worst, delay);
+    printf("APP - Alarm published %lu ms after arrival (worst %lu ms)\n",
+           (unsigned long)(delay * 1000 / CLOCK_SECOND),
+           (unsigned long)(alarm_worst * 1000 / CLOCK_SECOND));
+    return;
+  }
+
+  c = channel_table_due(clock_time());
+  if(c != NULL) {
+    publish_channel(c);
+    return;
+  }
+
+  publish_from(&line_queue, pub_topic, MQTT_QOS_LEVEL_0, line_since);
+}
+/*---------------------------------------------------------------------------*/
+/* 1 if the reading matches the alarm rule */
+static int
+reading_is_alarm(const struct sensor_record *reading)
+{
+  uint8_t i;
+
+  if(conf.alarm_key[0] == '\0') {
+    return 0;
+  }
+  for(i = 0; i < reading->count; i++) {
+    if(strcmp(reading->field[i].key, conf.alarm_key) == 0) {
+      return reading->field[i].value >= conf.alarm_level;
+    }
+  }
+
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Alarm lines go to their own queue when they have their own topic, and to
+ * the head of the normal one otherwise, or when their own queue is full.
+ * Either way they are published next
+ */
+static int
+queue_alarm(const char *line, uint8_t len)
+{
+  int queued = 0;
+
+  if(alarm_topic != NULL) {
+    if(pub_queue_count(&alarm_queue) == 0) {
+      alarm_since = clock_time();
+    }
+    queued = pub_queue_put(&alarm_queue, line, len);
+  }
+  if(!queued) {
+    queued = pub_queue_put_front(&line_queue, line, len);
+    if(queued) {
+      line_queued();
+    }
+  }
+
+  alarm_count++;
+  if(!queued) {
+    printf("APP - Alarm queue full, alarm %u dropped\n", alarm_count);
+  }
+  return queued;
+}
+/*---------------------------------------------------------------------------*/
+/* A tagged line, tag is the length of "<id>:" */
+static int
+route_line(const char *line, uint8_t tag, uint8_t len)
+{
+  struct channel *c = channel_table_get(line, tag - 1);
+
+  if(c == NULL) {
+    printf("APP - Channel table full, line dropped (%u)\n",
+           channel_table_unrouted());
+    return 0;
+  }
+  if(!channel_table_put(c, line + tag, len - tag, clock_time())) {
+    printf("APP - Channel %s full, line dropped (%u)\n", c->id,
+           pub_queue_dropped(&c->batch));
+    return 0;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Wake up when the next channel batch is due */
+static void
+schedule_channels(void)
+{
+  clock_time_t next = channel_table_next_due(clock_time());
+
+  if(next == (clock_time_t)-1) {
+    etimer_stop(&channel_timer);
+    return;
+  }
+  /* Due now but not published: the connection is busy, try again soon */
+  etimer_set(&channel_timer, MAX(next, STATE_MACHINE_PERIODIC));
+}
+/*---------------------------------------------------------------------------*/
+/* 1 if any field of the reading moved beyond its deadband */
+static int
+reading_changed(const struct sensor_record *reading)
+{
+  uint8_t changed = 0;
+  uint8_t i;
+
+  for(i = 0; i < reading->count; i++) {
+    changed |= deadband_pass(reading->field[i].key, reading->field[i].value);
+  }
+
+  return changed;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Queue one summary row per field for the window that just ended. A field
+ * is left out if its mean stayed within the deadband and it didn't swing by
+ * more than that within the window either
+ */
+static void
+queue_summary(void)
+{
+  char row[SENSOR_AGG_ROW_MAX];
+  struct sensor_agg_summary s;
+  uint8_t i;
+  int len;
+
+  for(i = 0; i < sensor_agg_fields(); i++) {
+    if(!sensor_agg_summary(i, &s) ||
+       (!deadband_pass(s.key, s.mean) &&
+        (uint32_t)s.max - (uint32_t)s.min < (uint32_t)deadband_delta(s.key))) {
+      continue;
+    }
+    len = sensor_agg_format(i, row, sizeof(row));
+    if(len > 0 && pub_queue_put(&line_queue, row, len)) {
+      line_queued();
+    } else if(len > 0) {
+      printf("Publish queue full, summary dropped (%u)\n",
+             pub_queue_dropped(&line_queue));
+    }
+  }
+  sensor_agg_reset();
+}
+/*---------------------------------------------------------------------------*/
+/* End of a publish interval: summaries, and a heartbeat if it was quiet */
+static void
+window_end(void)
+{
+  if(conf.heartbeat > 0 && ++quiet_windows >= conf.heartbeat) {
+    /* Everything goes out with the heartbeat */
+    deadband_expire();
+    heartbeat_due = 1;
+  }
+
+  if(conf.aggregate) {
+    queue_summary();
+  }
 }
 /*---------------------------------------------------------------------------*/
 static void
 connect_to_broker(void)
 {
+  struct broker *b = broker_list_current(&conf.brokers);
+
+  if(conf.brokers.current != session_broker) {
+    /* Whatever session we had is on the previous broker */
+    saved_flags &= ~SAVED_FLAG_SESSION;
+    session_broker = conf.brokers.current;
+    state_dirty = 1;
+  }
+
   //mqtt_set_username_password(&conn, username, password);
   /* Connect to MQTT server */
-  mqtt_connect(&conn, conf.broker_ip, conf.broker_port,
-               conf.pub_interval * 3);
+  /* In seconds: as learnt by keep-alive.c, at most DEFAULT_KEEP_ALIVE_TIMER */
+  mqtt_connect(&conn, b->host, b->port, keep_alive_period());
+  if(DEFAULT_PERSISTENT_SESSION) {
+    /*
+     * mqtt_connect() always asks for a clean session. The CONNECT packet is
+     * only built once TCP is up, so clearing the flag here still counts
+     */
+    conn.connect_vhdr_flags &= ~MQTT_VHDR_CLEAN_SESSION_FLAG;
+  }
 
+  t_connect = clock_time();
+  t_connected = t_connect;
+  ready_reported = 0;
   state = STATE_CONNECTING;
 }
 /*---------------------------------------------------------------------------*/
 static void
 state_machine(void)
 {
+  /* Flash writes happen here, in process context, never in a callback */
+  if(state_dirty) {
+    save_state();
+  }
+
   switch(state) {
   case STATE_INIT:
     /* If we have just been configured register MQTT connection */
-    mqtt_register(&conn, &test_serial, client_id, mqtt_event,
+    mqtt_register(&conn, &mqtt_client_process, client_id, mqtt_event,
                   MAX_TCP_SEGMENT_SIZE);
 
     conn.auto_reconnect = 0;
@@ -453,17 +1336,25 @@ state_machine(void)
     /* Notice there is no "break" here, it will continue to the
      * STATE_REGISTERED
      */
+    /* fall through */
   case STATE_REGISTERED:
     if(uip_ds6_get_global(ADDR_PREFERRED) != NULL) {
       /* Registered and with a public IP. Connect */
     //  printf("Registered. Connect attempt %u\n", connect_attempt);
+      waiting_for_net = 0;
+      if(t_net == 0) {
+        t_net = clock_time() - boot_time;
+      }
       connect_to_broker();
+      etimer_set(&publish_periodic_timer, NET_CONNECT_PERIODIC);
 
     } else {
+      /* route_changed() polls us as soon as RPL gives us a route */
+      waiting_for_net = 1;
       leds_on(LEDS_GREEN);
       ctimer_set(&ct, NO_NET_LED_DURATION, publish_led_off, NULL);
+      etimer_set(&publish_periodic_timer, NET_CONNECT_FALLBACK);
     }
-    etimer_set(&publish_periodic_timer, NET_CONNECT_PERIODIC);
     return;
     break;
 
@@ -475,8 +1366,14 @@ state_machine(void)
     break;
 
   case STATE_CONNECTED:
+    if(switching) {
+      /* Reconnect once the broker has let us go */
+      mqtt_disconnect(&conn);
+      state = STATE_CONNECTING;
+      break;
+    }
     /* Notice there's no "break" here, it will continue to subscribe */
-
+    /* fall through */
   case STATE_PUBLISHING:
     /* If the timer expired, the connection is stable. */
     if(timer_expired(&connection_life)) {
@@ -489,15 +1386,33 @@ state_machine(void)
 
     if(mqtt_ready(&conn) && conn.out_buffer_sent) {
       /* Connected. Publish */
-      if(state == STATE_CONNECTED) {
+      if(state == STATE_CONNECTED && !(saved_flags & SAVED_FLAG_SESSION)) {
         subscribe();
         state = STATE_PUBLISHING;
+        etimer_set(&publish_periodic_timer, conf.pub_interval);
+        return;
+      }
 
-      } else {
+      if(state == STATE_CONNECTED) {
+        /* Resumed session: the broker still has our subscription */
+        state = STATE_PUBLISHING;
+        is_it_ready = 1;
+        resubscribe = !session_checked;
+        session_checked = 1;
+        connection_ready("resumed");
+      }
+
+      if(pub_queue_count(&alarm_queue) > 0 ||
+         pub_queue_count(&line_queue) > 0 || heartbeat_due ||
+         channel_table_due(clock_time()) != NULL) {
         leds_on(LEDS_GREEN);
         printf("Publishing\n");
         ctimer_set(&ct, PUBLISH_LED_ON_DURATION, publish_led_off, NULL);
         publish();
+      } else if(resubscribe) {
+        /* Nothing to send: renew the subscription off the critical path */
+        resubscribe = 0;
+        subscribe();
       }
       etimer_set(&publish_periodic_timer, conf.pub_interval);
 
@@ -521,6 +1436,20 @@ state_machine(void)
 
   case STATE_DISCONNECTED:
     printf("Disconnected\n");
+    /*
+     * Another broker to try: right away, no backoff. A connection that had
+     * been stable gets one retry on the same broker first
+     */
+    if(switching || (connect_attempt > 0 &&
+                     broker_list_failed(&conf.brokers))) {
+      switching = 0;
+      mqtt_disconnect(&conn);
+      printf("APP - Trying broker %s\n",
+             broker_list_current(&conf.brokers)->host);
+      etimer_set(&publish_periodic_timer, FAILOVER_INTERVAL);
+      state = STATE_REGISTERED;
+      return;
+    }
     if(connect_attempt < RECONNECT_ATTEMPTS ||
        RECONNECT_ATTEMPTS == RETRY_FOREVER) {
       /* Disconnect and backoff */
@@ -562,42 +1491,66 @@ state_machine(void)
 }
 
 
-/*---------------------FUNÇÃO IMPORTANTE PARA FUNCIONAMENTO DO UART----------*/
-
-static void
-keep_uart_on(void)
-{
-  cc26xx_uart_set_input(serial_line_input_byte);
-}
-
-static void
-release_uart(void)
+/*---------------------------------------------------------------------------*/
+/*
+ * A valid UART line, from the router. Only queues it: the router polls us
+ * afterwards and state_machine() publishes. 0 if the line was dropped
+ */
+static int
+mqtt_input(const struct router_line *l)
 {
-	cc26xx_uart_set_input(NULL);
+  if(reading_is_alarm(l->reading)) {
+    /* No batching: published as soon as the link is free */
+    if(conf.aggregate && l->tag == 0) {
+      sensor_agg_add(l->reading);
+    }
+    return queue_alarm(l->text, l->len);
+  }
+  if(l->tag > 0) {
+    /* Batched per channel, no aggregation or deadband */
+    return route_line(l->text, l->tag, l->len);
+  }
+  if(conf.aggregate) {
+    sensor_agg_add(l->reading);
+    return 1;
+  }
+  if(!reading_changed(l->reading)) {
+    /* Every field within its deadband */
+    return 1;
+  }
+  if(!pub_queue_put(&line_queue, l->text, l->len)) {
+    printf("Publish queue full, line dropped (%u)\n",
+           pub_queue_dropped(&line_queue));
+    return 0;
+  }
+  line_queued();
+  return 1;
 }
-
 /*---------------------------------------------------------------------------*/
- 
- //AUTOSTART_PROCESSES(&test_serial);
- 
- 
- 
-PROCESS_THREAD(test_serial, ev, data)
+PROCESS_THREAD(mqtt_client_process, ev, data)
 {
 	PROCESS_BEGIN();
 	
+	stack_wm_init();
+	boot_time = clock_time();
+	uip_ds6_notification_add(&route_notification, route_changed);
 	
-	buf_ptr = app_buffer; 
-	int len;	
 	
 	if(init_config() != 1) {
 		PROCESS_EXIT();
 	}
 
 	update_config();
+
+	router_add(&mqtt_sink);
+#if DEFAULT_UDP_SINK
+	router_add(&net_uart_sink);
+#endif
+#if DEFAULT_SPOOL_SINK
+	router_add(&spool_sink);
+#endif
    
 	printf("\nProcesso para receber dados via serial, aguardando dados...\n");
-	//keep_uart_on();
    
 	//printf("Entrando no while principal");
 	while(is_it_ready != 1){
@@ -610,33 +1563,27 @@ PROCESS_THREAD(test_serial, ev, data)
 			//for(unsigned long int i=0; i<50000; i++);	
 		}
 	printf("Entrando no while principal");
+	etimer_set(&window_timer, conf.pub_interval);
 	while(1){
-		
-		//if(is_it_ready){
-			keep_uart_on();
-		//}
-
-		PROCESS_WAIT_EVENT_UNTIL(ev == serial_line_event_message);
-		if(ev == serial_line_event_message) {
-			printf("received line: %s\n", (char *)data);
-	   		int remaining = APP_BUFFER_SIZE;
-			len = snprintf(buf_ptr, remaining, (char *)data);
-
-			printf("\nDado armazenado no buffer com sucesso\n");			
-	     	remaining -= len;
-	     	buf_ptr += len;
-
-	 		release_uart();  
-
-	     	if(len < 0 || len >= remaining) {
-				printf("Buffer too short. Have %d, need %d + \\0\n", remaining, len);
-				return;
-			
-			//state_machine();
-			
-			}
-			
+		schedule_channels();
+
+		PROCESS_WAIT_EVENT();
+		if(ev == PROCESS_EVENT_TIMER && data == &window_timer) {
+			window_end();
+			etimer_reset(&window_timer);
+			state_machine();
+		} else if((ev == PROCESS_EVENT_TIMER &&
+		           (data == &publish_periodic_timer ||
+		            data == &channel_timer)) ||
+		          ev == PROCESS_EVENT_POLL) {
+			/*
+			 * Reconnects, lines left over from the last publish and
+			 * lines the router just handed to mqtt_input()
+			 */
 			state_machine();
+		} else if(ev == mqtt_update_event) {
+			/* apps/mqtt is done with a QoS 0 publish */
+			published(MQTT_QOS_LEVEL_0);
 		}
 	
 	}
@@ -644,36 +1591,4 @@ PROCESS_THREAD(test_serial, ev, data)
 	PROCESS_END();
 }
 
-/*------------------------------------------------------------------------*/
-/*------------------------------------------------------------------------*/
-
-
-/*
-PROCESS_THREAD(mqtt_demo_process, ev, data)
-{
-
-  PROCESS_BEGIN();
-
- // printf("MQTT Demo Process\n");
-
-  if(init_config() != 1) {
-    PROCESS_EXIT();
-  }
-
-  update_config();
-  //printf("Entrando no while principal");
-  while(1) {
-    PROCESS_YIELD();
-    
-    if((ev == PROCESS_EVENT_TIMER && data == &publish_periodic_timer) ||
-       ev == PROCESS_EVENT_POLL) {
-              	state_machine();
-    }
-    
-    
-    
-  }
-
-  PROCESS_END();
-}*/
 /*---------------------------------------------------------------------------*/
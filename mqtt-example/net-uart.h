@@ -27,22 +27,31 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
  * OF THE POSSIBILITY OF SUCH DAMAGE.
  */
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     UDP sink of the UART router, see net-uart.c
+ */
+/*---------------------------------------------------------------------------*/
 #ifndef NET_UART_H_
 #define NET_UART_H_
 /*---------------------------------------------------------------------------*/
-#include "net/ip/uip.h"
-
-#include <stdint.h>
+#include "contiki-conf.h"
+#include "router.h"
 /*---------------------------------------------------------------------------*/
-#define NET_UART_IP_ADDR_STRLEN   64
+/* Bytes of lines waiting for the next datagram */
+#ifdef NET_UART_CONF_QUEUE_SIZE
+#define NET_UART_QUEUE_SIZE NET_UART_CONF_QUEUE_SIZE
+#else
+#define NET_UART_QUEUE_SIZE 128
+#endif
+#if NET_UART_QUEUE_SIZE <= ROUTER_LINE_MAX
+#error "The UDP sink queue must hold a line of ROUTER_LINE_MAX"
+#endif
 /*---------------------------------------------------------------------------*/
 PROCESS_NAME(net_uart_process);
-/*---------------------------------------------------------------------------*/
-typedef struct net_uart_config_s {
-  char remote_address[NET_UART_IP_ADDR_STRLEN];
-  uint16_t remote_port;
-  uint8_t enable;
-} net_uart_config_t;
+
+extern struct sink net_uart_sink;
 /*---------------------------------------------------------------------------*/
 #endif /* NET_UART_H_ */
 /*---------------------------------------------------------------------------*/
@@ -0,0 +1,85 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     AES-CCM payload protection, see payload-sec.h
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "payload-sec.h"
+#include "lib/ccm-star.h"
+
+#include <stdint.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+/* Nonce: node id, epoch and seq (big endian), then a zero byte */
+#define NONCE_EPOCH     PAYLOAD_SEC_ID_LEN
+#define NONCE_SEQ       (NONCE_EPOCH + 4)
+
+static uint8_t key[PAYLOAD_SEC_KEY_LEN];
+static uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+/*---------------------------------------------------------------------------*/
+static int
+hex_digit(char c)
+{
+  if(c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  c |= 0x20;
+  if(c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+int
+payload_sec_init(const char *hex)
+{
+  uint8_t i;
+  int hi;
+  int lo;
+
+  if(strlen(hex) != 2 * PAYLOAD_SEC_KEY_LEN) {
+    return 0;
+  }
+  for(i = 0; i < PAYLOAD_SEC_KEY_LEN; i++) {
+    hi = hex_digit(hex[2 * i]);
+    lo = hex_digit(hex[2 * i + 1]);
+    if(hi < 0 || lo < 0) {
+      return 0;
+    }
+    key[i] = (hi << 4) | lo;
+  }
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+payload_sec_start(const uint8_t *node_id)
+{
+  CCM_STAR.set_key(key);
+  memcpy(nonce, node_id, PAYLOAD_SEC_ID_LEN);
+  memset(nonce + PAYLOAD_SEC_ID_LEN, 0,
+         CCM_STAR_NONCE_LENGTH - PAYLOAD_SEC_ID_LEN);
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+payload_sec_seal(uint8_t *buf, uint8_t hdr_len, uint16_t len,
+                 uint32_t epoch, uint16_t seq)
+{
+  if(len < hdr_len || len - hdr_len > PAYLOAD_SEC_MAX_LEN) {
+    return 0;
+  }
+
+  nonce[NONCE_EPOCH] = epoch >> 24;
+  nonce[NONCE_EPOCH + 1] = (epoch >> 16) & 0xFF;
+  nonce[NONCE_EPOCH + 2] = (epoch >> 8) & 0xFF;
+  nonce[NONCE_EPOCH + 3] = epoch & 0xFF;
+  nonce[NONCE_SEQ] = seq >> 8;
+  nonce[NONCE_SEQ + 1] = seq & 0xFF;
+
+  CCM_STAR.aead(nonce, buf + hdr_len, len - hdr_len, buf, hdr_len,
+                buf + len, PAYLOAD_SEC_MIC_LEN, 1);
+
+  return len + PAYLOAD_SEC_MIC_LEN;
+}
+/*---------------------------------------------------------------------------*/
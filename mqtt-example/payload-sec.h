@@ -0,0 +1,69 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     End-to-end protection of published payloads with AES-CCM.
+ *
+ *     The header row of a payload ("$<client_id>,<epoch>,<seq>\n") stays in
+ *     clear and is authenticated as additional data; the rows after it are
+ *     encrypted in place and a PAYLOAD_SEC_MIC_LEN byte MIC is appended.
+ *     The 13-byte nonce is the node id of the client id, the 32-bit epoch
+ *     and the 16-bit sequence number (big endian), padded with zeros, so
+ *     the subscriber rebuilds it from the header row.
+ *     The caller must never reuse an (epoch, seq) pair under one key.
+ *
+ *     The key schedule and the constant part of the nonce are set up once
+ *     per session by payload_sec_start(); sealing a payload only writes the
+ *     epoch and the sequence number into the nonce. AES_128 is global, so
+ *     link-layer security would have to re-key before every payload;
+ *     mqtt-example.c refuses to build with both.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef PAYLOAD_SEC_H_
+#define PAYLOAD_SEC_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+#ifdef PAYLOAD_SEC_CONF_MIC_LEN
+#define PAYLOAD_SEC_MIC_LEN PAYLOAD_SEC_CONF_MIC_LEN
+#else
+#define PAYLOAD_SEC_MIC_LEN 8
+#endif
+
+#define PAYLOAD_SEC_KEY_LEN 16
+/* Bytes of the link-layer address in the client id, and in the nonce */
+#define PAYLOAD_SEC_ID_LEN  6
+/*
+ * Longest part that can be encrypted: ccm-star.c walks the message with
+ * an 8-bit offset, which must not wrap past the last block
+ */
+#define PAYLOAD_SEC_MAX_LEN 240
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Set the key
+ * \param hex 32 hex digits
+ * \return 1 on success, 0 if the key is malformed
+ */
+int payload_sec_init(const char *hex);
+
+/**
+ * \brief Load the key schedule and the node id into the nonce
+ *
+ * Once per session, and again if anything else has used AES_128 since
+ */
+void payload_sec_start(const uint8_t *node_id);
+
+/**
+ * \brief Encrypt and authenticate a payload in place
+ * \param buf     Header row, then the rows to encrypt; PAYLOAD_SEC_MIC_LEN
+ *                bytes of room must follow
+ * \param hdr_len Length of the header row, authenticated only
+ * \param len     Length of the whole payload
+ * \return The new length, with the MIC, or 0 if the payload is too long
+ */
+uint16_t payload_sec_seal(uint8_t *buf, uint8_t hdr_len, uint16_t len,
+                          uint32_t epoch, uint16_t seq);
+/*---------------------------------------------------------------------------*/
+#endif /* PAYLOAD_SEC_H_ */
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,78 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     CFS-backed state record, see persist.h
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "persist.h"
+#include "cfs/cfs.h"
+#include "lib/crc16.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+struct persist_hdr {
+  uint16_t len;
+  uint16_t crc;
+};
+
+/* CRC of the record in flash; 0 until one has been read or written */
+static uint16_t saved_crc;
+/*---------------------------------------------------------------------------*/
+static uint16_t
+record_crc(const void *data, uint16_t len)
+{
+  /* Never 0, so that 0 can mean "nothing saved" */
+  uint16_t crc = crc16_data((const unsigned char *)data, len, 0);
+
+  return crc ? crc : 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+persist_load(void *data, uint16_t len)
+{
+  struct persist_hdr hdr;
+  int fd;
+  int ok;
+
+  fd = cfs_open(PERSIST_FILE, CFS_READ);
+  if(fd < 0) {
+    return 0;
+  }
+
+  ok = cfs_read(fd, &hdr, sizeof(hdr)) == sizeof(hdr) && hdr.len == len &&
+    cfs_read(fd, data, len) == len && hdr.crc == record_crc(data, len);
+  cfs_close(fd);
+
+  if(ok) {
+    saved_crc = hdr.crc;
+  }
+  return ok;
+}
+/*---------------------------------------------------------------------------*/
+int
+persist_save(const void *data, uint16_t len)
+{
+  struct persist_hdr hdr;
+  int fd;
+  int ok;
+
+  hdr.len = len;
+  hdr.crc = record_crc(data, len);
+  if(hdr.crc == saved_crc) {
+    return 1;
+  }
+
+  fd = cfs_open(PERSIST_FILE, CFS_WRITE);
+  if(fd < 0) {
+    return 0;
+  }
+
+  ok = cfs_write(fd, &hdr, sizeof(hdr)) == sizeof(hdr) &&
+    cfs_write(fd, data, len) == len;
+  cfs_close(fd);
+
+  saved_crc = ok ? hdr.crc : 0;
+  return ok;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,38 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     State kept in flash across reboots.
+ *
+ *     One record, written to a CFS file together with its length and a
+ *     CRC-16, so a record from a different firmware or a torn write reads
+ *     back as missing. persist_save() does not touch the flash when the
+ *     record is unchanged since the last load or save.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef PERSIST_H_
+#define PERSIST_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+#ifdef PERSIST_CONF_FILE
+#define PERSIST_FILE PERSIST_CONF_FILE
+#else
+#define PERSIST_FILE "mqtt-state"
+#endif
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Read the record
+ * \return 1 if a valid record of exactly len bytes was read into data
+ */
+int persist_load(void *data, uint16_t len);
+
+/**
+ * \brief Write the record, unless it is unchanged
+ * \return 0 if the write failed
+ */
+int persist_save(const void *data, uint16_t len);
+/*---------------------------------------------------------------------------*/
+#endif /* PERSIST_H_ */
+/*---------------------------------------------------------------------------*/
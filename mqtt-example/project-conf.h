@@ -72,14 +72,101 @@
  * i.e the fd00::1/64 address the Border router defaults to
  */
 #define MQTT_DEMO_BROKER_IP_ADDR  "fd00::1/64"
+
+/*
+ * Brokers to use, comma-separated, in order of preference (see
+ * broker-list.h). IPv4 addresses are mapped into DEFAULT_NAT64_PREFIX at run
+ * time, so "52.207.176.25" reaches mqtt.tago.io as above. The node moves to
+ * the next broker as soon as one fails, and to the one that answers fastest
+ */
+#ifndef DEFAULT_BROKERS
+#define DEFAULT_BROKERS           MQTT_DEMO_BROKER_IP_ADDR
+#endif
+#define DEFAULT_NAT64_PREFIX      "fd00::ffff:"
 /*---------------------------------------------------------------------------*/
 /* Default configuration values */
 #define DEFAULT_EVENT_TYPE_ID        "status"
 #define DEFAULT_SUBSCRIBE_CMD_TYPE   "curt"
 #define DEFAULT_BROKER_PORT          1883
 #define DEFAULT_PUBLISH_INTERVAL     (30 * CLOCK_SECOND)
+
+/*
+ * Keep-alive sent to the broker, in seconds. The node pings after this much
+ * silence, or less if idle connections die sooner (NAT, border router)
+ */
 #define DEFAULT_KEEP_ALIVE_TIMER     60
 
+/*
+ * 1: publish a min/max/mean/count summary per field every publish interval
+ * instead of every line received over the UART
+ */
+#ifndef DEFAULT_AGGREGATE
+#define DEFAULT_AGGREGATE            1
+#endif
+
+/*
+ * Report by exception: a field is published only when it has moved by
+ * DEFAULT_DEADBAND hundredths or more (0: every value). After
+ * DEFAULT_HEARTBEAT publish intervals without a publish, one goes out anyway
+ * (0: never). Both can be changed with "set" on the subscribed topic
+ */
+#ifndef DEFAULT_DEADBAND
+#define DEFAULT_DEADBAND             100
+#endif
+#define DEFAULT_HEARTBEAT            10
+
+/*
+ * A reading with DEFAULT_ALARM_KEY at or above DEFAULT_ALARM_LEVEL hundredths
+ * skips aggregation, deadband and batching and is published right away on
+ * DEFAULT_ALARM_TOPIC at DEFAULT_ALARM_QOS. With an empty topic it goes to
+ * the head of the normal queue instead. "alarm <key>=<level>" on the
+ * subscribed topic changes the rule, "alarm" alone turns it off
+ */
+#define DEFAULT_ALARM_KEY            "CO"
+#define DEFAULT_ALARM_LEVEL          100000
+#define DEFAULT_ALARM_TOPIC          "teste/alarm"
+#define DEFAULT_ALARM_QOS            MQTT_QOS_LEVEL_1
+
+/*
+ * 1: connect with clean session off, so the broker keeps our subscription
+ * (and queues QoS 1 commands) across reconnects and SUBSCRIBE is skipped
+ */
+#define DEFAULT_PERSISTENT_SESSION   1
+
+/*
+ * Sinks of the UART router besides MQTT: every valid line is also sent to
+ * DEFAULT_UDP_SINK_ADDR port DEFAULT_UDP_SINK_PORT (net-uart.c), and/or
+ * appended to a file in flash (spool.c). "make UDP=1" and "make SPOOL=1"
+ */
+#ifndef DEFAULT_UDP_SINK
+#define DEFAULT_UDP_SINK             0
+#endif
+#define DEFAULT_UDP_SINK_ADDR        "fd00::1"
+#define DEFAULT_UDP_SINK_PORT        7777
+#ifndef DEFAULT_SPOOL_SINK
+#define DEFAULT_SPOOL_SINK           0
+#endif
+
+/*
+ * 1: encrypt and authenticate every payload with AES-CCM (payload-sec.h)
+ * under DEFAULT_PAYLOAD_KEY, 32 hex digits, the same as "mqtt-client.py
+ * --key". "make KEY=<hex>" turns it on with that key
+ */
+#ifndef DEFAULT_PAYLOAD_SEC
+#define DEFAULT_PAYLOAD_SEC          0
+#endif
+#ifndef DEFAULT_PAYLOAD_KEY
+#define DEFAULT_PAYLOAD_KEY          ""
+#endif
+
+/*
+ * 1: print a "TR" record for every UART line and every publish (trace.h),
+ * to be replayed on the host by tools/trace-replay.py. "make TRACE=1"
+ */
+#ifndef DEFAULT_TRACE
+#define DEFAULT_TRACE                0
+#endif
+
 #undef IEEE802154_CONF_PANID
 #define IEEE802154_CONF_PANID        0xABCD
 
@@ -101,6 +188,17 @@
 #undef UIP_CONF_MAX_ROUTES
 #define UIP_CONF_MAX_ROUTES          3
 #endif
+
+/*
+ * Client ID, topics, credentials and the strings of the configuration are
+ * kept at their actual length in a small arena (str-arena.c). The RAM this
+ * gives back, compared to five BUFFER_SIZE arrays plus 104 bytes of
+ * fixed-size config strings, goes to the queue of lines waiting to be
+ * published. The arena also holds the address of every broker of
+ * DEFAULT_BROKERS.
+ */
+#define STR_ARENA_CONF_SIZE          128
+#define PUB_QUEUE_CONF_SIZE          (5 * BUFFER_SIZE + 104 - STR_ARENA_CONF_SIZE)
 /*---------------------------------------------------------------------------*/
 #undef NETSTACK_CONF_RDC
 #define NETSTACK_CONF_RDC          nullrdc_driver
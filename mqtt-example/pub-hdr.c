@@ -0,0 +1,32 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Size of MQTT PUBLISH packets, see pub-hdr.h
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "pub-hdr.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+uint8_t
+pub_hdr_len_size(uint32_t remaining)
+{
+  if(remaining < 128) {
+    return 1;
+  } else if(remaining < 16384) {
+    return 2;
+  } else if(remaining < 2097152) {
+    return 3;
+  }
+  return 4;
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+pub_hdr_wire_len(uint16_t topic_len, uint32_t payload_len, uint8_t qos)
+{
+  uint32_t remaining = 2 + topic_len + (qos > 0 ? 2 : 0) + payload_len;
+
+  return 1 + pub_hdr_len_size(remaining) + remaining;
+}
+/*---------------------------------------------------------------------------*/
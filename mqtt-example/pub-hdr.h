@@ -0,0 +1,40 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Size of MQTT PUBLISH packets on the wire.
+ *
+ *     apps/mqtt encodes the header itself in mqtt_publish(); the node uses
+ *     pub_hdr_wire_len() only to account for the bytes it publishes. The
+ *     pre-serialised header cache that bench/ measures is in
+ *     bench/pub-hdr-cache.h, not in the node's build.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef PUB_HDR_H_
+#define PUB_HDR_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+#ifdef PUB_HDR_CONF_MAX_TOPIC_LEN
+#define PUB_HDR_MAX_TOPIC_LEN PUB_HDR_CONF_MAX_TOPIC_LEN
+#else
+#define PUB_HDR_MAX_TOPIC_LEN 32
+#endif
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Bytes the "remaining length" field takes for a given length
+ */
+uint8_t pub_hdr_len_size(uint32_t remaining);
+
+/**
+ * \brief Bytes a whole PUBLISH packet takes on the wire
+ * \param topic_len Length of its topic
+ * \param payload_len Length of its payload
+ * \param qos Its QoS level; above 0 the packet carries a 2-byte identifier
+ */
+uint32_t pub_hdr_wire_len(uint16_t topic_len, uint32_t payload_len,
+                          uint8_t qos);
+/*---------------------------------------------------------------------------*/
+#endif /* PUB_HDR_H_ */
+/*---------------------------------------------------------------------------*/
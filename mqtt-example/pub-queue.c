@@ -0,0 +1,134 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     FIFO of UART lines waiting to be published, see pub-queue.h
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "pub-queue.h"
+#include "sys/cc.h"
+
+#include <stdint.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+static void
+ring_write(struct pub_queue *q, uint16_t pos, const uint8_t *src, uint16_t len)
+{
+  uint16_t first = MIN(len, q->size - pos);
+
+  memcpy(&q->ring[pos], src, first);
+  memcpy(q->ring, src + first, len - first);
+}
+/*---------------------------------------------------------------------------*/
+static void
+ring_read(struct pub_queue *q, uint16_t pos, uint8_t *dst, uint16_t len)
+{
+  uint16_t first = MIN(len, q->size - pos);
+
+  memcpy(dst, &q->ring[pos], first);
+  memcpy(dst + first, q->ring, len - first);
+}
+/*---------------------------------------------------------------------------*/
+int
+pub_queue_put(struct pub_queue *q, const char *line, uint8_t len)
+{
+  uint16_t tail;
+
+  if(q->fill + len + 1 > q->size) {
+    q->dropped++;
+    return 0;
+  }
+
+  tail = (q->head + q->fill) % q->size;
+  q->ring[tail] = len;
+  ring_write(q, (tail + 1) % q->size, (const uint8_t *)line, len);
+  q->fill += len + 1;
+  q->lines++;
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+pub_queue_put_front(struct pub_queue *q, const char *line, uint8_t len)
+{
+  if(q->fill + len + 1 > q->size) {
+    q->dropped++;
+    return 0;
+  }
+
+  q->head = (q->head + q->size - (len + 1)) % q->size;
+  q->ring[q->head] = len;
+  ring_write(q, (q->head + 1) % q->size, (const uint8_t *)line, len);
+  q->fill += len + 1;
+  q->lines++;
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+pub_queue_drain(struct pub_queue *q, char *buf, uint16_t size)
+{
+  uint16_t out = 0;
+  uint8_t len;
+
+  q->drained = 0;
+  q->drained_lines = 0;
+
+  while(q->lines > 0) {
+    len = q->ring[q->head];
+
+    /* Room for the separator and the terminating NUL */
+    if(out + len + (out ? 1 : 0) + 1 > size) {
+      if(out > 0) {
+        break;
+      }
+      /* Would never fit: drop it rather than block the queue */
+      q->dropped++;
+      q->head = (q->head + len + 1) % q->size;
+      q->fill -= len + 1;
+      q->lines--;
+      continue;
+    }
+    if(out) {
+      buf[out++] = '\n';
+    }
+
+    ring_read(q, (q->head + 1) % q->size, (uint8_t *)&buf[out], len);
+    out += len;
+    q->head = (q->head + len + 1) % q->size;
+    q->fill -= len + 1;
+    q->lines--;
+    q->drained += len + 1;
+    q->drained_lines++;
+  }
+
+  if(size > 0) {
+    buf[out] = '\0';
+  }
+
+  return out;
+}
+/*---------------------------------------------------------------------------*/
+void
+pub_queue_undrain(struct pub_queue *q)
+{
+  /* The ring still holds them just behind the head */
+  q->head = (q->head + q->size - q->drained) % q->size;
+  q->fill += q->drained;
+  q->lines += q->drained_lines;
+  q->drained = 0;
+  q->drained_lines = 0;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+pub_queue_count(struct pub_queue *q)
+{
+  return q->lines;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+pub_queue_dropped(struct pub_queue *q)
+{
+  return q->dropped;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,91 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     FIFOs of UART lines waiting to be published.
+ *
+ *     Lines are stored back to back in a ring buffer, each one prefixed by
+ *     its length, so short lines don't waste space. When the MQTT connection
+ *     is ready, pub_queue_drain() packs as many whole lines as fit into the
+ *     publish buffer, one per row. A queue is declared with PUB_QUEUE(), so
+ *     lines of different priority can wait in queues of their own.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef PUB_QUEUE_H_
+#define PUB_QUEUE_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "sys/cc.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+#ifdef PUB_QUEUE_CONF_SIZE
+#define PUB_QUEUE_SIZE PUB_QUEUE_CONF_SIZE
+#else
+#define PUB_QUEUE_SIZE 256
+#endif
+/*---------------------------------------------------------------------------*/
+struct pub_queue {
+  uint8_t *ring;
+  uint16_t size;
+  uint16_t head;      /* Next byte to read */
+  uint16_t fill;      /* Bytes in use, including the length prefixes */
+  uint16_t lines;
+  uint16_t dropped;
+  uint16_t drained;       /* Bytes and lines taken by the last drain */
+  uint16_t drained_lines;
+};
+
+/**
+ * \brief Declare a static queue of size bytes
+ */
+#define PUB_QUEUE(name, size)                                   \
+  static uint8_t CC_CONCAT(name, _ring)[size];                  \
+  static struct pub_queue name = { CC_CONCAT(name, _ring), (size), 0, 0, 0, \
+                                   0, 0, 0 }
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Append a line to the queue
+ * \param line The line, without line terminator
+ * \param len Its length, at most 255 bytes
+ * \return 1 if queued, 0 if there was no room (the line is dropped)
+ */
+int pub_queue_put(struct pub_queue *q, const char *line, uint8_t len);
+
+/**
+ * \brief Insert a line ahead of all the others, so it goes out first
+ * \return 1 if queued, 0 if there was no room (the line is dropped)
+ */
+int pub_queue_put_front(struct pub_queue *q, const char *line, uint8_t len);
+
+/**
+ * \brief Move queued lines into a publish buffer
+ * \param buf Destination, NUL-terminated on return
+ * \param size Size of buf
+ * \return Length of the text written to buf, 0 if the queue was empty
+ *
+ * Lines are separated by '\n'. A line that doesn't fit in the remaining
+ * space stays queued for the next call. A line longer than the whole of buf
+ * would never fit: it is dropped and counted in pub_queue_dropped().
+ */
+uint16_t pub_queue_drain(struct pub_queue *q, char *buf, uint16_t size);
+
+/**
+ * \brief Put back the lines taken by the last pub_queue_drain()
+ *
+ * For a publish that could not be sent. They are queued again ahead of the
+ * others, in their order; the queue must not have changed since the drain.
+ */
+void pub_queue_undrain(struct pub_queue *q);
+
+/**
+ * \brief Number of lines waiting
+ */
+uint16_t pub_queue_count(struct pub_queue *q);
+
+/**
+ * \brief Number of lines dropped because the queue was full
+ */
+uint16_t pub_queue_dropped(struct pub_queue *q);
+/*---------------------------------------------------------------------------*/
+#endif /* PUB_QUEUE_H_ */
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,114 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     UART line router, see router.h
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "router.h"
+#include "channel-table.h"
+#include "trace.h"
+#include "dev/serial-line.h"
+#include "sys/cc.h"
+
+#if CONTIKI_TARGET_SRF06_CC26XX
+#include "dev/cc26xx-uart.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+static struct sink *sinks;
+static struct sensor_record reading;
+static uint16_t rejected;
+/*---------------------------------------------------------------------------*/
+PROCESS(router_process, "UART router");
+/*---------------------------------------------------------------------------*/
+/*
+ * Only the CC26xx needs the UART input handler to be attached by hand.
+ * Other targets (Cooja, native) feed serial-line from their own drivers.
+ */
+static void
+keep_uart_on(void)
+{
+#if CONTIKI_TARGET_SRF06_CC26XX
+  cc26xx_uart_set_input(serial_line_input_byte);
+#endif
+}
+/*---------------------------------------------------------------------------*/
+void
+router_add(struct sink *s)
+{
+  struct sink **last;
+
+  for(last = &sinks; *last != NULL; last = &(*last)->next);
+  s->next = NULL;
+  *last = s;
+  process_start(s->process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+router_rejected(void)
+{
+  return rejected;
+}
+/*---------------------------------------------------------------------------*/
+void
+router_print_stats(void)
+{
+  struct sink *s;
+
+  printf("APP - Sinks:");
+  for(s = sinks; s != NULL; s = s->next) {
+    printf(" %s %u in, %u dropped, %u out;", s->name, s->lines, s->dropped,
+           s->sent);
+  }
+  printf(" rejected %u\n", rejected);
+}
+/*---------------------------------------------------------------------------*/
+static void
+route(const char *text)
+{
+  struct router_line l;
+  struct sink *s;
+  int rv;
+
+  l.text = text;
+  l.len = MIN(strlen(text), ROUTER_LINE_MAX);
+  l.reading = &reading;
+#if DEFAULT_TRACE
+  trace_line(text);
+#endif
+
+  /* Only well-formed lines go anywhere */
+  l.tag = channel_tag_len(text, l.len);
+  rv = sensor_line_parse(text + l.tag, l.len - l.tag, &reading);
+  if(rv != SENSOR_LINE_OK) {
+    rejected++;
+    printf("Bad sensor line (%d), dropped\n", rv);
+    return;
+  }
+
+  for(s = sinks; s != NULL; s = s->next) {
+    s->lines++;
+    if(!s->input(&l)) {
+      s->dropped++;
+    }
+    process_poll(s->process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(router_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  keep_uart_on();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == serial_line_event_message);
+    route((const char *)data);
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
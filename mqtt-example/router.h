@@ -0,0 +1,73 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     UART line router.
+ *
+ *     router_process owns the UART. Every line is validated once, by
+ *     sensor-line.c, and each valid one is handed to every sink: the MQTT
+ *     client, and optionally a UDP listener (net-uart.c) and a spool file
+ *     in flash (spool.c). A sink's input() only queues the line, in a queue
+ *     of its own, and the router then polls the sink's process to send it.
+ *     A sink that is slow, or down, fills and drops from its own queue and
+ *     never holds up the router or the other sinks.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef ROUTER_H_
+#define ROUTER_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "sys/process.h"
+#include "sensor-line.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+/* Longest line passed on: a full serial-line buffer, less its NUL */
+#ifdef SERIAL_LINE_CONF_BUFSIZE
+#define ROUTER_LINE_MAX (SERIAL_LINE_CONF_BUFSIZE - 1)
+#else
+#define ROUTER_LINE_MAX 127
+#endif
+#if ROUTER_LINE_MAX > 255
+#error "ROUTER_LINE_MAX must be 255 or less"
+#endif
+/*---------------------------------------------------------------------------*/
+PROCESS_NAME(router_process);
+/*---------------------------------------------------------------------------*/
+struct router_line {
+  const char *text;                     /* As received, NUL-terminated */
+  uint8_t len;
+  uint8_t tag;                          /* Length of "<id>:", 0 if none */
+  const struct sensor_record *reading;  /* The text after the tag */
+};
+
+struct sink {
+  struct sink *next;
+  const char *name;
+  struct process *process;              /* Polled after every line */
+  /*
+   * Queue the line, 0 if it had to be dropped. Runs in the router's
+   * context: no timers, no sending
+   */
+  int (*input)(const struct router_line *l);
+  uint16_t lines;                       /* Handed to input() */
+  uint16_t dropped;                     /* Refused by input() */
+  uint16_t sent;                        /* Passed on, counted by the sink */
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Add a sink after the others, and start its process
+ */
+void router_add(struct sink *s);
+
+/**
+ * \brief Number of lines that failed validation
+ */
+uint16_t router_rejected(void);
+
+/**
+ * \brief Print the counters of every sink
+ */
+void router_print_stats(void);
+/*---------------------------------------------------------------------------*/
+#endif /* ROUTER_H_ */
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,144 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Windowed min/max/mean/count per field, see sensor-agg.h
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "sensor-agg.h"
+
+#include <stdio.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+struct agg_field {
+  char key[SENSOR_LINE_KEY_LEN + 1];
+  int32_t min;
+  int32_t max;
+  int64_t sum;
+  uint16_t count;
+};
+
+static struct agg_field fields[SENSOR_AGG_FIELDS];
+static uint8_t used;
+static uint16_t overflow;
+/*---------------------------------------------------------------------------*/
+static struct agg_field *
+lookup(const char *key)
+{
+  uint8_t i;
+
+  for(i = 0; i < used; i++) {
+    if(strcmp(fields[i].key, key) == 0) {
+      return &fields[i];
+    }
+  }
+
+  if(used == SENSOR_AGG_FIELDS) {
+    return NULL;
+  }
+  strcpy(fields[used].key, key);
+  fields[used].count = 0;
+  return &fields[used++];
+}
+/*---------------------------------------------------------------------------*/
+void
+sensor_agg_add(const struct sensor_record *rec)
+{
+  struct agg_field *f;
+  int32_t v;
+  uint8_t i;
+
+  for(i = 0; i < rec->count; i++) {
+    f = lookup(rec->field[i].key);
+    if(f == NULL || f->count == UINT16_MAX) {
+      overflow++;
+      continue;
+    }
+    v = rec->field[i].value;
+    if(f->count == 0) {
+      f->min = f->max = v;
+      f->sum = 0;
+    } else if(v < f->min) {
+      f->min = v;
+    } else if(v > f->max) {
+      f->max = v;
+    }
+    f->sum += v;
+    f->count++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+sensor_agg_fields(void)
+{
+  return used;
+}
+/*---------------------------------------------------------------------------*/
+/* Appends label and hundredths as "-12.34", without floating point */
+static int
+append_fixed(char *buf, uint16_t size, int len, const char *label, int32_t v)
+{
+  uint32_t a = v < 0 ? -(uint32_t)v : (uint32_t)v;
+  int rv;
+
+  if(len < 0 || len >= size) {
+    return -1;
+  }
+  rv = snprintf(buf + len, size - len, "%s%s%lu.%02u", label,
+                v < 0 ? "-" : "", (unsigned long)(a / SENSOR_LINE_SCALE),
+                (unsigned)(a % SENSOR_LINE_SCALE));
+
+  return rv < 0 ? -1 : len + rv;
+}
+/*---------------------------------------------------------------------------*/
+int
+sensor_agg_summary(uint8_t i, struct sensor_agg_summary *s)
+{
+  struct agg_field *f;
+
+  if(i >= used || fields[i].count == 0) {
+    return 0;
+  }
+  f = &fields[i];
+
+  s->key = f->key;
+  s->count = f->count;
+  s->min = f->min;
+  s->max = f->max;
+  /* Mean rounded half away from zero */
+  s->mean = f->sum >= 0 ? (f->sum + f->count / 2) / f->count :
+    (f->sum - f->count / 2) / f->count;
+
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+sensor_agg_format(uint8_t i, char *buf, uint16_t size)
+{
+  struct sensor_agg_summary s;
+  int len;
+
+  if(!sensor_agg_summary(i, &s)) {
+    return 0;
+  }
+
+  len = snprintf(buf, size, "k=%s,n=%u", s.key, s.count);
+  len = append_fixed(buf, size, len, ",min=", s.min);
+  len = append_fixed(buf, size, len, ",max=", s.max);
+  len = append_fixed(buf, size, len, ",mean=", s.mean);
+
+  return len < 0 || len >= size ? 0 : len;
+}
+/*---------------------------------------------------------------------------*/
+void
+sensor_agg_reset(void)
+{
+  used = 0;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+sensor_agg_overflow(void)
+{
+  return overflow;
+}
+/*---------------------------------------------------------------------------*/
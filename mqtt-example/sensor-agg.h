@@ -0,0 +1,74 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Windowed summaries of the sensor readings.
+ *
+ *     Every valid line is folded into a running min/max/sum/count per field,
+ *     in constant memory per field. At the end of a window the application
+ *     formats one summary row per field with sensor_agg_format(), publishes
+ *     them instead of the raw lines, and starts the next window with
+ *     sensor_agg_reset().
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef SENSOR_AGG_H_
+#define SENSOR_AGG_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "sensor-line.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+#ifdef SENSOR_AGG_CONF_FIELDS
+#define SENSOR_AGG_FIELDS SENSOR_AGG_CONF_FIELDS
+#else
+#define SENSOR_AGG_FIELDS 4
+#endif
+
+/* Longest summary row, with its terminating NUL */
+#define SENSOR_AGG_ROW_MAX 72
+/*---------------------------------------------------------------------------*/
+struct sensor_agg_summary {
+  const char *key;
+  uint16_t count;
+  int32_t min;
+  int32_t max;
+  int32_t mean;
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Add a reading to the current window
+ *
+ * Fields are matched by key. Fields beyond SENSOR_AGG_FIELDS distinct ones
+ * are counted by sensor_agg_overflow()
+ */
+void sensor_agg_add(const struct sensor_record *rec);
+
+/**
+ * \brief Number of fields with at least one sample in the current window
+ */
+uint8_t sensor_agg_fields(void);
+
+/**
+ * \brief Summary of field i so far
+ * \return 0 if i is out of range
+ */
+int sensor_agg_summary(uint8_t i, struct sensor_agg_summary *s);
+
+/**
+ * \brief Write the summary of field i as "k=CO,n=12,min=4.20,max=5.10,mean=4.55"
+ * \return Length written, 0 if i is out of range or buf too small
+ */
+int sensor_agg_format(uint8_t i, char *buf, uint16_t size);
+
+/**
+ * \brief Start a new window
+ */
+void sensor_agg_reset(void);
+
+/**
+ * \brief Samples dropped because the field table was full
+ */
+uint16_t sensor_agg_overflow(void);
+/*---------------------------------------------------------------------------*/
+#endif /* SENSOR_AGG_H_ */
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,164 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Single-pass sensor line tokenizer, see sensor-line.h
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "sensor-line.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+#define IS_DIGIT(c)      ((uint8_t)((c) - '0') < 10)
+#define IS_ALPHA(c)      ((uint8_t)(((c) | 0x20) - 'a') < 26)
+#define IS_KEY_CHAR(c)   (IS_ALPHA(c) || IS_DIGIT(c) || (c) == '_')
+#define IS_BLANK(c)      ((c) == ' ' || (c) == '\t')
+
+/* Most lines have no blanks: skip_blanks() only gets called on one */
+#define SKIP_BLANKS(p, end) \
+  ((p) < (end) && IS_BLANK(*(p)) ? skip_blanks((p), (end)) : (p))
+
+/* Largest integer part that can still fit once scaled */
+#define INT_PART_MAX     (INT32_MAX / SENSOR_LINE_SCALE)
+/*---------------------------------------------------------------------------*/
+static const char *
+skip_blanks(const char *p, const char *end)
+{
+  while(p < end && IS_BLANK(*p)) {
+    p++;
+  }
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * "[-+]digits[.digits]" into hundredths. *pp is left on the first
+ * character after the number
+ */
+static int
+parse_value(const char **pp, const char *end, int32_t *value)
+{
+  const char *p = *pp;
+  uint32_t ip = 0;
+  uint32_t frac = 0;
+  uint8_t decimals = 0;
+  uint8_t digits = 0;
+  uint8_t neg = 0;
+
+  if(p < end && (*p == '-' || *p == '+')) {
+    neg = *p == '-';
+    p++;
+  }
+
+  while(p < end && IS_DIGIT(*p)) {
+    ip = ip * 10 + (*p++ - '0');
+    /* Stop before ip itself wraps; the exact check needs the fraction */
+    if(ip > INT_PART_MAX) {
+      return SENSOR_LINE_OVERFLOW;
+    }
+    digits++;
+  }
+
+  if(p < end && *p == '.') {
+    p++;
+    while(p < end && IS_DIGIT(*p)) {
+      if(decimals < SENSOR_LINE_DECIMALS) {
+        frac = frac * 10 + (*p - '0');
+        decimals++;
+      }
+      p++;
+      digits++;
+    }
+  }
+
+  if(digits == 0) {
+    return SENSOR_LINE_BAD_VALUE;
+  }
+
+  for(; decimals < SENSOR_LINE_DECIMALS; decimals++) {
+    frac *= 10;
+  }
+
+  if(ip > (INT32_MAX - frac) / SENSOR_LINE_SCALE) {
+    return SENSOR_LINE_OVERFLOW;
+  }
+  ip = ip * SENSOR_LINE_SCALE + frac;
+  *value = neg ? -(int32_t)ip : (int32_t)ip;
+  *pp = p;
+
+  return SENSOR_LINE_OK;
+}
+/*---------------------------------------------------------------------------*/
+int
+sensor_line_parse(const char *line, uint16_t len, struct sensor_record *rec)
+{
+  const char *p = line;
+  const char *end = line + len;
+  struct sensor_field *f;
+  uint8_t k;
+  int rv;
+
+  while(end > p && (end[-1] == '\r' || end[-1] == ' ')) {
+    end--;
+  }
+  p = SKIP_BLANKS(p, end);
+  if(p == end) {
+    return SENSOR_LINE_EMPTY;
+  }
+
+  rec->count = 0;
+  rec->named = IS_ALPHA(*p);
+
+  for(;;) {
+    if(rec->count == SENSOR_LINE_MAX_FIELDS) {
+      return SENSOR_LINE_TOO_MANY;
+    }
+    f = &rec->field[rec->count];
+
+    /* A field is named if it starts with a letter; all or none must be */
+    k = 0;
+    if(p < end && IS_ALPHA(*p)) {
+      if(!rec->named) {
+        return SENSOR_LINE_MIXED;
+      }
+      while(p < end && IS_KEY_CHAR(*p)) {
+        if(k == SENSOR_LINE_KEY_LEN) {
+          return SENSOR_LINE_BAD_KEY;
+        }
+        f->key[k++] = *p++;
+      }
+      p = SKIP_BLANKS(p, end);
+      if(p == end || *p != '=') {
+        return SENSOR_LINE_BAD_KEY;
+      }
+      p++;
+      p = SKIP_BLANKS(p, end);
+    } else if(rec->named) {
+      return SENSOR_LINE_MIXED;
+    } else {
+      f->key[k++] = 'f';
+      f->key[k++] = '0' + rec->count;
+    }
+    f->key[k] = '\0';
+
+    rv = parse_value(&p, end, &f->value);
+    if(rv != SENSOR_LINE_OK) {
+      return rv;
+    }
+    rec->count++;
+
+    p = SKIP_BLANKS(p, end);
+    if(p == end) {
+      return SENSOR_LINE_OK;
+    }
+    if(*p != ',') {
+      return SENSOR_LINE_SYNTAX;
+    }
+    p++;
+    p = SKIP_BLANKS(p, end);
+    if(p == end) {
+      /* A trailing ',' */
+      return SENSOR_LINE_SYNTAX;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,74 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Validating parser for the sensor lines received over the UART.
+ *
+ *     A line is either a list of "key=value" pairs or plain CSV values,
+ *     separated by commas, e.g. "CO=421.83,LPG=1448.36" or "421.83,1448.36".
+ *     sensor_line_parse() walks the line once, checks it and converts it
+ *     into a fixed-size record with the values in fixed point, without
+ *     copying the line or calling into the stdio library.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef SENSOR_LINE_H_
+#define SENSOR_LINE_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+#ifdef SENSOR_LINE_CONF_MAX_FIELDS
+#define SENSOR_LINE_MAX_FIELDS SENSOR_LINE_CONF_MAX_FIELDS
+#else
+#define SENSOR_LINE_MAX_FIELDS 8
+#endif
+
+/* CSV fields are named "f0".."f9" */
+#if SENSOR_LINE_MAX_FIELDS > 10
+#error "SENSOR_LINE_MAX_FIELDS must be 10 or less"
+#endif
+
+/* Longest key, not counting the terminating NUL */
+#ifdef SENSOR_LINE_CONF_KEY_LEN
+#define SENSOR_LINE_KEY_LEN SENSOR_LINE_CONF_KEY_LEN
+#else
+#define SENSOR_LINE_KEY_LEN 7
+#endif
+
+/* Values are kept in hundredths: "421.83" is 42183. Extra digits are cut */
+#define SENSOR_LINE_DECIMALS 2
+#define SENSOR_LINE_SCALE    100
+/*---------------------------------------------------------------------------*/
+/* sensor_line_parse() return values */
+#define SENSOR_LINE_OK          0
+#define SENSOR_LINE_EMPTY      -1 /* Nothing but blanks */
+#define SENSOR_LINE_BAD_KEY    -2 /* Key too long, bad character or no '=' */
+#define SENSOR_LINE_BAD_VALUE  -3 /* Not a decimal number */
+#define SENSOR_LINE_OVERFLOW   -4 /* Doesn't fit in the fixed-point range */
+#define SENSOR_LINE_TOO_MANY   -5 /* More than SENSOR_LINE_MAX_FIELDS */
+#define SENSOR_LINE_MIXED      -6 /* Some fields named and some not */
+#define SENSOR_LINE_SYNTAX     -7 /* Not ',' after a value, or a final ',' */
+/*---------------------------------------------------------------------------*/
+struct sensor_field {
+  char key[SENSOR_LINE_KEY_LEN + 1];  /* "f<position>" for CSV lines */
+  int32_t value;                      /* In 1/SENSOR_LINE_SCALE units */
+};
+
+struct sensor_record {
+  uint8_t count;
+  uint8_t named;                      /* 1 for key=value, 0 for CSV */
+  struct sensor_field field[SENSOR_LINE_MAX_FIELDS];
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Check a line and convert it into a record
+ * \param line The line, need not be NUL-terminated
+ * \param len Its length. A trailing '\r' is ignored
+ * \param rec Filled in on success, undefined otherwise
+ * \return SENSOR_LINE_OK or one of the negative SENSOR_LINE_ codes
+ */
+int sensor_line_parse(const char *line, uint16_t len,
+                      struct sensor_record *rec);
+/*---------------------------------------------------------------------------*/
+#endif /* SENSOR_LINE_H_ */
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,136 @@
+/*
+ * Cooja test script for the mqtt-example mesh (see mesh-gen.py).
+ *
+ * Feeds every mqtt-example node with bursts of UART lines and counts the
+ * radio frames each mote transmits, split into unfragmented frames and
+ * 6LoWPAN FRAG1/FRAGN fragments. Everything is written to COOJA.testlog for
+ * mesh-report.py. The @...@ placeholders are filled in by mesh-gen.py.
+ *
+ * Each line carries the node ID, a per-node counter and the wall-clock time
+ * of injection, so the host subscriber log can be matched against it. The
+ * time is in ms modulo 10^7 to stay within the range of the node's line
+ * parser; mesh-report.py unwraps it. Every ALARM_EVERY-th line of a node
+ * also carries a CO reading above the node's default alarm level.
+ */
+var DEPTHS = "@DEPTHS@";
+var PAYLOAD = @PAYLOAD@;
+var BATCH = @BATCH@;
+var INTERVAL = @INTERVAL@;
+var WARMUP = @WARMUP@;
+var ALARM_EVERY = @ALARM_EVERY@;
+
+/* Broker and border router live on the host: run in real time */
+sim.setSpeedLimit(1.0);
+
+var nodes = [];
+var counter = {};
+DEPTHS.split(",").forEach(function(entry) {
+  var kv = entry.split(":");
+  nodes.push(parseInt(kv[0]));
+  counter[kv[0]] = 0;
+  log.log("NODE " + kv[0] + " " + kv[1] + "\n");
+});
+log.log("PARAMS payload=" + PAYLOAD + " batch=" + BATCH +
+        " interval=" + INTERVAL + " alarm_every=" + ALARM_EVERY + "\n");
+
+/* Per transmitting mote: frames, bytes, FRAG1, FRAGN */
+var frames = {};
+
+function mac_header_len(d) {
+  var fcf = (d[0] & 0xff) | ((d[1] & 0xff) << 8);
+  var panid_comp = (fcf >> 6) & 1;
+  var dst_mode = (fcf >> 10) & 3;
+  var src_mode = (fcf >> 14) & 3;
+  var len = 3;
+
+  if(dst_mode != 0) {
+    len += 2 + (dst_mode == 2 ? 2 : 8);
+  }
+  if(src_mode != 0) {
+    len += (panid_comp ? 0 : 2) + (src_mode == 2 ? 2 : 8);
+  }
+  return len;
+}
+
+var observer = new java.util.Observer({
+  update: function(obs, arg) {
+    var conn = sim.getRadioMedium().getLastConnection();
+    if(conn == null) {
+      return;
+    }
+    var src = conn.getSource();
+    var pkt = src.getLastPacketTransmitted();
+    if(pkt == null) {
+      return;
+    }
+    var d = pkt.getPacketData();
+    var id = src.getMote().getID();
+    var f = frames[id] || (frames[id] = [0, 0, 0, 0]);
+
+    f[0]++;
+    f[1] += d.length;
+
+    /* Data frames only: look at the 6LoWPAN dispatch */
+    if(d.length > 3 && (d[0] & 7) == 1) {
+      var dispatch = d[mac_header_len(d)] & 0xf8;
+      if(dispatch == 0xc0) {
+        f[2]++;
+      } else if(dispatch == 0xe0) {
+        f[3]++;
+      }
+    }
+  }
+});
+
+var medium = sim.getRadioMedium();
+if(medium.addRadioTransmissionObserver) {
+  medium.addRadioTransmissionObserver(observer);
+} else {
+  medium.addRadioMediumObserver(observer);
+}
+
+function padded_line(id) {
+  var line = "n=" + id + ",k=" + counter[id] + ",t=" +
+             (java.lang.System.currentTimeMillis() % 10000000);
+  if(ALARM_EVERY > 0 && counter[id] % ALARM_EVERY == 0) {
+    line += ",CO=9999";
+  }
+  line += ",p=";
+  while(line.length < PAYLOAD) {
+    line += "0";
+  }
+  return line;
+}
+
+function dump() {
+  for(var id in frames) {
+    var f = frames[id];
+    log.log("FRAMES " + id + " " + f[0] + " " + f[1] + " " + f[2] + " " +
+            f[3] + "\n");
+  }
+  log.testOK();
+}
+
+TIMEOUT(@TIMEOUT@, dump());
+
+GENERATE_MSG(WARMUP, "tick");
+
+while(true) {
+  YIELD();
+
+  if(msg == "tick") {
+    for(var i = 0; i < nodes.length; i++) {
+      var id = nodes[i];
+      for(var b = 0; b < BATCH; b++) {
+        counter[id]++;
+        var line = padded_line(id);
+        write(sim.getMoteWithID(id), line);
+        log.log("INJ " + time + " " + id + " " + counter[id] + " " +
+                line.length + "\n");
+      }
+    }
+    GENERATE_MSG(INTERVAL, "tick");
+  } else if(msg.indexOf("APP -") >= 0 || msg.indexOf("Disconnected") >= 0) {
+    log.log("MOTE " + time + " " + id + " " + msg + "\n");
+  }
+}
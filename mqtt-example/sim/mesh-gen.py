@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+### Generates a headless Cooja scenario for the 6LoWPAN/RPL mesh:
+### one rpl-border-router (mote 1) plus a tree of mqtt-example nodes.
+###
+### Nodes are laid out in layers 40m apart with a 50m UDGM range, so a node
+### in layer L can only hear layers L-1 and L+1 and is always L hops from the
+### border router. The resulting .csc loads mesh-bench.js, which feeds the
+### nodes' UART and logs radio frames for mesh-report.py.
+
+import argparse
+import os
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+LAYER_SPACING = 40.0
+TX_RANGE = 50.0
+# Children must stay below sqrt(TX_RANGE^2 - LAYER_SPACING^2) = 30m off
+# their parent's y to remain in range
+MAX_CHILD_OFFSET = 25.0
+INTERFERENCE_RANGE = 100.0
+
+MOTE_INTERFACES = [
+    "org.contikios.cooja.interfaces.Position",
+    "org.contikios.cooja.interfaces.Battery",
+    "org.contikios.cooja.contikimote.interfaces.ContikiVib",
+    "org.contikios.cooja.contikimote.interfaces.ContikiMoteID",
+    "org.contikios.cooja.contikimote.interfaces.ContikiRS232",
+    "org.contikios.cooja.contikimote.interfaces.ContikiBeeper",
+    "org.contikios.cooja.interfaces.RimeAddress",
+    "org.contikios.cooja.contikimote.interfaces.ContikiIPAddress",
+    "org.contikios.cooja.contikimote.interfaces.ContikiRadio",
+    "org.contikios.cooja.contikimote.interfaces.ContikiButton",
+    "org.contikios.cooja.contikimote.interfaces.ContikiPIR",
+    "org.contikios.cooja.contikimote.interfaces.ContikiClock",
+    "org.contikios.cooja.contikimote.interfaces.ContikiLED",
+    "org.contikios.cooja.contikimote.interfaces.ContikiCFS",
+    "org.contikios.cooja.contikimote.interfaces.ContikiEEPROM",
+    "org.contikios.cooja.interfaces.Mote2MoteRelations",
+    "org.contikios.cooja.interfaces.MoteAttributes",
+]
+
+
+def build_tree(depth, fanout):
+    """Returns [(mote_id, layer, x, y)], border router first."""
+    motes = [(1, 0, 0.0, 0.0)]
+    parents = [(0.0, 0.0)]
+    spacing = min(20.0, 2 * MAX_CHILD_OFFSET / max(fanout - 1, 1))
+    next_id = 2
+    for layer in range(1, depth + 1):
+        children = []
+        for (_, py) in parents:
+            for i in range(fanout):
+                y = py + (i - (fanout - 1) / 2.0) * spacing
+                x = layer * LAYER_SPACING
+                motes.append((next_id, layer, x, y))
+                children.append((x, y))
+                next_id += 1
+        parents = children
+    return motes
+
+
+def motetype(ident, desc, source, target, make_args=""):
+    out = ["    <motetype>",
+           "      org.contikios.cooja.contikimote.ContikiMoteType",
+           "      <identifier>%s</identifier>" % ident,
+           "      <description>%s</description>" % desc,
+           "      <source>%s</source>" % source,
+           "      <commands>make %s.cooja TARGET=cooja%s</commands>"
+           % (target, make_args)]
+    for iface in MOTE_INTERFACES:
+        out.append("      <moteinterface>%s</moteinterface>" % iface)
+    out += ["      <symbols>false</symbols>",
+            "    </motetype>"]
+    return out
+
+
+def mote(mote_id, x, y, ident):
+    return ["    <mote>",
+            "      <breakpoints />",
+            "      <interface_config>",
+            "        org.contikios.cooja.interfaces.Position",
+            "        <x>%.1f</x>" % x,
+            "        <y>%.1f</y>" % y,
+            "        <z>0.0</z>",
+            "      </interface_config>",
+            "      <interface_config>",
+            "        org.contikios.cooja.contikimote.interfaces.ContikiMoteID",
+            "        <id>%d</id>" % mote_id,
+            "      </interface_config>",
+            "      <motetype_identifier>%s</motetype_identifier>" % ident,
+            "    </mote>"]
+
+
+def main():
+    p = argparse.ArgumentParser(
+        description="Generate a Cooja scenario for the mqtt-example mesh")
+    p.add_argument("--depth", type=int, default=3,
+                   help="number of hops below the border router")
+    p.add_argument("--fanout", type=int, default=2,
+                   help="children per node")
+    p.add_argument("--payload", type=int, default=32,
+                   help="bytes per UART line fed to each node")
+    p.add_argument("--batch", type=int, default=1,
+                   help="UART lines fed back-to-back per interval")
+    p.add_argument("--interval", type=int, default=30,
+                   help="seconds between UART bursts")
+    p.add_argument("--warmup", type=int, default=120,
+                   help="seconds to let RPL and MQTT settle before feeding")
+    p.add_argument("--duration", type=int, default=1800,
+                   help="simulated seconds to run")
+    p.add_argument("--alarm-every", type=int, default=0,
+                   help="make every Nth line of a node an alarm (0: none)")
+    p.add_argument("--seed", type=int, default=123456)
+    p.add_argument("--slip-port", type=int, default=60001)
+    p.add_argument("-o", "--output", default="mesh.csc")
+    args = p.parse_args()
+
+    motes = build_tree(args.depth, args.fanout)
+    depths = ",".join("%d:%d" % (m[0], m[1]) for m in motes[1:])
+
+    with open(os.path.join(HERE, "mesh-bench.js")) as f:
+        script = f.read()
+    params = {
+        "@DEPTHS@": depths,
+        "@PAYLOAD@": str(args.payload),
+        "@BATCH@": str(args.batch),
+        "@INTERVAL@": str(args.interval * 1000),
+        "@WARMUP@": str(args.warmup * 1000),
+        "@ALARM_EVERY@": str(args.alarm_every),
+        "@TIMEOUT@": str((args.warmup + args.duration) * 1000),
+    }
+    for k, v in params.items():
+        script = script.replace(k, v)
+    script = script.replace("&", "&amp;").replace("<", "&lt;") \
+                   .replace(">", "&gt;")
+
+    out = ['<?xml version="1.0" encoding="UTF-8"?>',
+           "<simconf>",
+           "  <simulation>",
+           "    <title>mqtt-example mesh d=%d f=%d p=%d b=%d</title>"
+           % (args.depth, args.fanout, args.payload, args.batch),
+           "    <randomseed>%d</randomseed>" % args.seed,
+           "    <motedelay_us>1000000</motedelay_us>",
+           "    <radiomedium>",
+           "      org.contikios.cooja.radiomediums.UDGM",
+           "      <transmitting_range>%.1f</transmitting_range>" % TX_RANGE,
+           "      <interference_range>%.1f</interference_range>"
+           % INTERFERENCE_RANGE,
+           "      <success_ratio_tx>1.0</success_ratio_tx>",
+           "      <success_ratio_rx>1.0</success_ratio_rx>",
+           "    </radiomedium>",
+           "    <events>",
+           "      <logoutput>40000</logoutput>",
+           "    </events>"]
+    out += motetype("br", "RPL border router",
+                    "[CONTIKI_DIR]/examples/ipv6/rpl-border-router/"
+                    "border-router.c", "border-router")
+    out += motetype("node", "mqtt-example node",
+                    os.path.join(os.path.dirname(HERE), "mqtt-example.c"),
+                    "mqtt-example", " RAW=1")
+    for (mote_id, layer, x, y) in motes:
+        out += mote(mote_id, x, y, "br" if layer == 0 else "node")
+    out += ["  </simulation>",
+            "  <plugin>",
+            "    org.contikios.cooja.plugins.SerialSocketServer",
+            "    <mote_arg>0</mote_arg>",
+            "    <plugin_config>",
+            "      <port>%d</port>" % args.slip_port,
+            "      <bound>true</bound>",
+            "    </plugin_config>",
+            "  </plugin>",
+            "  <plugin>",
+            "    org.contikios.cooja.plugins.ScriptRunner",
+            "    <plugin_config>",
+            "      <script>%s</script>" % script,
+            "      <active>true</active>",
+            "    </plugin_config>",
+            "  </plugin>",
+            "</simconf>"]
+
+    with open(args.output, "w") as f:
+        f.write("\n".join(out) + "\n")
+    print("%s: %d nodes, depth %d" % (args.output, len(motes) - 1, args.depth))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+### Summarises a mesh run: joins COOJA.testlog (written by mesh-bench.js)
+### with the host subscriber log (one "<unix time> <payload>" per line, as
+### produced by run-mesh.sh) and reports, per mesh depth, delivery ratio,
+### end-to-end latency, 6LoWPAN fragmentation and the time from boot to the
+### first publish, the latency of alarm lines against routine ones and how
+### long (re)connections take to become ready to publish.
+###
+### Latency is UART to subscriber, broker and host included; nothing in the
+### log times a single hop. "e2e_per_depth" is that latency divided by the
+### depth, and "depth_step" how much it grows from the depth above, which
+### leaves the broker and host time out: the closest the log gets to the
+### cost of one more hop.
+
+import argparse
+import re
+import statistics
+import sys
+
+LINE_RE = re.compile(r"n=(\d+),k=(\d+),t=(\d+)(,CO=)?")
+
+# Printed by the node with its first publish, all in ms since boot
+BOOT_RE = re.compile(r"Boot \((\w+)\): net (\d+), connack (\d+), "
+                     r"suback (\d+), first publish (\d+) ms")
+
+# Printed on every connection, in ms since the CONNECT attempt
+CONN_RE = re.compile(r"Connected \((\w+)\): connack (\d+), ready (\d+) ms")
+
+# mesh-bench.js sends the injection time modulo this many ms
+T_WRAP = 10000000
+
+
+def percentile(values, pct):
+    if not values:
+        return float("nan")
+    values = sorted(values)
+    idx = min(len(values) - 1, int(round(pct / 100.0 * (len(values) - 1))))
+    return values[idx]
+
+
+def parse_testlog(path):
+    depth = {}
+    injected = {}
+    frames = {}
+    disconnects = {}
+    boot = {}
+    conns = {}
+    params = ""
+    with open(path) as f:
+        for line in f:
+            parts = line.split()
+            if not parts:
+                continue
+            if parts[0] == "NODE":
+                depth[int(parts[1])] = int(parts[2])
+            elif parts[0] == "PARAMS":
+                params = " ".join(parts[1:])
+            elif parts[0] == "INJ":
+                node = int(parts[2])
+                injected[node] = injected.get(node, 0) + 1
+            elif parts[0] == "FRAMES":
+                frames[int(parts[1])] = [int(x) for x in parts[2:6]]
+            elif parts[0] == "MOTE" and "Disconnect" in line:
+                node = int(parts[2])
+                disconnects[node] = disconnects.get(node, 0) + 1
+            elif parts[0] == "MOTE" and BOOT_RE.search(line):
+                m = BOOT_RE.search(line)
+                boot.setdefault(int(parts[2]),
+                                [int(m.group(i)) for i in range(2, 6)])
+            elif parts[0] == "MOTE" and CONN_RE.search(line):
+                m = CONN_RE.search(line)
+                conns.setdefault(m.group(1), []).append(
+                    (int(m.group(2)), int(m.group(3))))
+    return depth, injected, frames, disconnects, boot, conns, params
+
+
+def parse_sublog(path):
+    """Returns ({(node, k): latency_ms}, duplicates, set of alarm keys),
+    keeping the first copy of each line."""
+    received = {}
+    alarms = set()
+    duplicates = 0
+    with open(path) as f:
+        for line in f:
+            ts, _, payload = line.partition(" ")
+            try:
+                rx_ms = float(ts) * 1000.0
+            except ValueError:
+                continue
+            # A batched publish carries several lines
+            for m in LINE_RE.finditer(payload):
+                key = (int(m.group(1)), int(m.group(2)))
+                if key in received:
+                    duplicates += 1
+                    continue
+                received[key] = (rx_ms - int(m.group(3))) % T_WRAP
+                if m.group(4):
+                    alarms.add(key)
+    return received, duplicates, alarms
+
+
+def main():
+    p = argparse.ArgumentParser(description="Report on a mqtt-example mesh run")
+    p.add_argument("testlog", help="COOJA.testlog")
+    p.add_argument("sublog", help="subscriber log from run-mesh.sh")
+    args = p.parse_args()
+
+    depth, injected, frames, disconnects, boot, conns, params = \
+        parse_testlog(args.testlog)
+    received, duplicates, alarms = parse_sublog(args.sublog)
+
+    if not depth:
+        sys.exit("No NODE lines in %s" % args.testlog)
+
+    print("Run: %s, %d nodes" % (params, len(depth)))
+    print("%5s %6s %6s %6s %7s %9s %9s %13s %10s %7s %7s %6s %9s" %
+          ("depth", "nodes", "sent", "recv", "ratio", "lat_mean", "lat_p95",
+           "e2e_per_depth", "depth_step", "frames", "frags", "disc",
+           "first_pub"))
+
+    prev_mean = float("nan")
+    for d in sorted(set(depth.values())):
+        nodes = [n for n in depth if depth[n] == d]
+        sent = sum(injected.get(n, 0) for n in nodes)
+        lat = [v for (n, _), v in received.items() if depth.get(n) == d]
+        tx = [frames.get(n, [0, 0, 0, 0]) for n in nodes]
+        n_frames = sum(t[0] for t in tx)
+        n_frags = sum(t[2] + t[3] for t in tx)
+        disc = sum(disconnects.get(n, 0) for n in nodes)
+        mean = statistics.mean(lat) if lat else float("nan")
+        first = [boot[n][3] for n in nodes if n in boot]
+        print("%5d %6d %6d %6d %6.1f%% %8.0fms %8.0fms %12.0fms %9.0fms "
+              "%7d %7d %6d %8.0fms" %
+              (d, len(nodes), sent, len(lat),
+               100.0 * len(lat) / sent if sent else 0.0,
+               mean, percentile(lat, 95), mean / d, mean - prev_mean,
+               n_frames, n_frags, disc,
+               statistics.mean(first) if first else float("nan")))
+        prev_mean = mean
+
+    # Frames sent by the border router (mote 1) are downlink/ACK traffic
+    total_sent = sum(injected.values())
+    total_frags = sum(f[2] + f[3] for n, f in frames.items() if n != 1)
+    print("Total: %d/%d delivered (%.1f%%), %d duplicates, "
+          "%.2f fragments per delivered line" %
+          (len(received), total_sent,
+           100.0 * len(received) / total_sent if total_sent else 0.0,
+           duplicates,
+           float(total_frags) / len(received) if received else 0.0))
+
+    if boot:
+        means = [statistics.mean(b[i] for b in boot.values())
+                 for i in range(4)]
+        print("Bring-up (mean of %d nodes): net %.0fms, connack %.0fms, "
+              "suback %.0fms, first publish %.0fms, slowest %dms" %
+              tuple([len(boot)] + means +
+                    [max(b[3] for b in boot.values())]))
+
+    for how in sorted(conns):
+        c = conns[how]
+        print("Connections %-10s %4d: connack %.0fms, ready %.0fms "
+              "(p95 %.0fms)" %
+              (how, len(c), statistics.mean(x[0] for x in c),
+               statistics.mean(x[1] for x in c),
+               percentile([x[1] for x in c], 95)))
+
+    if alarms:
+        print("%8s %6s %9s %9s %9s" % ("class", "recv", "lat_mean", "lat_p95",
+                                       "lat_max"))
+        for name, keys in (("alarm", alarms),
+                           ("routine", set(received) - alarms)):
+            lat = [received[k] for k in keys]
+            print("%8s %6d %8.0fms %8.0fms %8.0fms" %
+                  (name, len(lat),
+                   statistics.mean(lat) if lat else float("nan"),
+                   percentile(lat, 95), max(lat) if lat else float("nan")))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,49 @@
+#!/bin/sh
+#
+# Runs the mqtt-example mesh headless in Cooja and prints the report.
+#
+#   ./run-mesh.sh [mesh-gen.py options, e.g. --depth 4 --payload 96]
+#
+# Needs java, mosquitto/mosquitto_sub on the host and sudo for tunslip6.
+# A broker already listening on port 1883 is reused.
+#
+CONTIKI=${CONTIKI:-$(cd ../../.. && pwd)}
+OUT=${OUT:-mesh-out}
+SLIP_PORT=${SLIP_PORT:-60001}
+
+set -e
+mkdir -p $OUT
+python3 mesh-gen.py -o $OUT/mesh.csc --slip-port $SLIP_PORT "$@"
+make -C $CONTIKI/tools tunslip6 > /dev/null
+
+PIDS=""
+cleanup() {
+  [ -n "$PIDS" ] && kill $PIDS 2> /dev/null
+  sudo pkill -f "tunslip6 -a 127.0.0.1 -p $SLIP_PORT" 2> /dev/null || true
+}
+trap cleanup EXIT INT TERM
+
+# The mosquitto stand-in. Listens on all addresses, so fd00::1 works as
+# soon as tunslip6 brings the tunnel up
+if ! nc -z localhost 1883 2> /dev/null; then
+  mosquitto -p 1883 > $OUT/mosquitto.log 2>&1 &
+  PIDS="$PIDS $!"
+fi
+
+(cd $OUT && exec java -mx512m -jar $CONTIKI/tools/cooja/dist/cooja.jar \
+   -nogui=mesh.csc -contiki=$CONTIKI > cooja.log 2>&1) &
+COOJA_PID=$!
+
+# Wait for the border router's serial socket
+while ! nc -z 127.0.0.1 $SLIP_PORT 2> /dev/null; do
+  kill -0 $COOJA_PID 2> /dev/null || { cat $OUT/cooja.log; exit 1; }
+  sleep 1
+done
+sudo $CONTIKI/tools/tunslip6 -a 127.0.0.1 -p $SLIP_PORT fd00::1/64 \
+  > $OUT/tunslip6.log 2>&1 &
+
+mosquitto_sub -h localhost -t 'teste/#' -F '@s.@N %p' > $OUT/sub.log &
+PIDS="$PIDS $!"
+
+wait $COOJA_PID || true
+python3 mesh-report.py $OUT/COOJA.testlog $OUT/sub.log
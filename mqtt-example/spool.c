@@ -0,0 +1,104 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Spool sink of the UART router, see spool.h
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "sys/process.h"
+#include "sys/etimer.h"
+#include "cfs/cfs.h"
+#include "spool.h"
+#include "pub-queue.h"
+#include "sys/cc.h"
+
+#include <stdint.h>
+#include <stdio.h>
+/*---------------------------------------------------------------------------*/
+/*
+ * A batch, or the longest line if that is longer, one row per line, plus
+ * the NUL that pub_queue_drain() adds
+ */
+#define SPOOL_BUFFER_SIZE MAX(SPOOL_BATCH, ROUTER_LINE_MAX + 1)
+static char buffer[SPOOL_BUFFER_SIZE + 1];
+static struct etimer flush_timer;
+static uint32_t spool_size;
+
+PUB_QUEUE(queue, SPOOL_QUEUE_SIZE);
+/*---------------------------------------------------------------------------*/
+PROCESS(spool_process, "Spool");
+/*---------------------------------------------------------------------------*/
+static int
+input(const struct router_line *l)
+{
+  if(spool_size + queue.fill + l->len + 1 > SPOOL_MAX_SIZE) {
+    return 0;
+  }
+  return pub_queue_put(&queue, l->text, l->len);
+}
+/*---------------------------------------------------------------------------*/
+struct sink spool_sink = { NULL, "spool", &spool_process, input, 0, 0, 0 };
+/*---------------------------------------------------------------------------*/
+static void
+flush(void)
+{
+  uint16_t len;
+  int fd;
+
+  fd = cfs_open(SPOOL_FILE, CFS_WRITE | CFS_APPEND);
+  if(fd < 0) {
+    printf("Spool: cannot open %s\n", SPOOL_FILE);
+    return;
+  }
+
+  while(pub_queue_count(&queue) > 0) {
+    len = pub_queue_drain(&queue, buffer, sizeof(buffer) - 1);
+    if(len == 0) {
+      break;
+    }
+    /* Rows are separated, not terminated, by the drain */
+    buffer[len++] = '\n';
+    if(cfs_write(fd, buffer, len) != len) {
+      printf("Spool: write failed, %u lines lost\n", queue.drained_lines);
+      break;
+    }
+    spool_size += len;
+    spool_sink.sent += queue.drained_lines;
+  }
+
+  cfs_close(fd);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(spool_process, ev, data)
+{
+  int fd;
+
+  PROCESS_BEGIN();
+
+  /* Carry on after what the last boot left */
+  fd = cfs_open(SPOOL_FILE, CFS_READ);
+  if(fd >= 0) {
+    spool_size = cfs_seek(fd, 0, CFS_SEEK_END);
+    cfs_close(fd);
+  }
+  printf("Spool: %s, %lu of %lu bytes used\n", SPOOL_FILE,
+         (unsigned long)spool_size, (unsigned long)SPOOL_MAX_SIZE);
+
+  while(1) {
+    PROCESS_YIELD();
+
+    if(ev == PROCESS_EVENT_POLL) {
+      if(queue.fill >= SPOOL_BATCH) {
+        etimer_stop(&flush_timer);
+        flush();
+      } else if(pub_queue_count(&queue) > 0 && etimer_expired(&flush_timer)) {
+        etimer_set(&flush_timer, SPOOL_FLUSH_INTERVAL);
+      }
+    } else if(ev == PROCESS_EVENT_TIMER && data == &flush_timer) {
+      flush();
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
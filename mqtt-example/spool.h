@@ -0,0 +1,59 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Spool sink of the UART router: valid UART lines are appended to a
+ *     file in flash, one per row, so a node with no network at all still
+ *     keeps its readings.
+ *
+ *     Lines are written in batches, when SPOOL_BATCH bytes are queued or
+ *     SPOOL_FLUSH_INTERVAL after the first of them, which spares the flash
+ *     a write per line. Once the file reaches SPOOL_MAX_SIZE further lines
+ *     are dropped, and counted, until the file is removed.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef SPOOL_H_
+#define SPOOL_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "router.h"
+/*---------------------------------------------------------------------------*/
+#ifdef SPOOL_CONF_FILE
+#define SPOOL_FILE SPOOL_CONF_FILE
+#else
+#define SPOOL_FILE "spool"
+#endif
+
+#ifdef SPOOL_CONF_MAX_SIZE
+#define SPOOL_MAX_SIZE SPOOL_CONF_MAX_SIZE
+#else
+#define SPOOL_MAX_SIZE 16384
+#endif
+
+/* Bytes of lines waiting to be written */
+#ifdef SPOOL_CONF_QUEUE_SIZE
+#define SPOOL_QUEUE_SIZE SPOOL_CONF_QUEUE_SIZE
+#else
+#define SPOOL_QUEUE_SIZE 128
+#endif
+#if SPOOL_QUEUE_SIZE <= ROUTER_LINE_MAX
+#error "The spool queue must hold a line of ROUTER_LINE_MAX"
+#endif
+
+#ifdef SPOOL_CONF_BATCH
+#define SPOOL_BATCH SPOOL_CONF_BATCH
+#else
+#define SPOOL_BATCH 96
+#endif
+
+#ifdef SPOOL_CONF_FLUSH_INTERVAL
+#define SPOOL_FLUSH_INTERVAL SPOOL_CONF_FLUSH_INTERVAL
+#else
+#define SPOOL_FLUSH_INTERVAL (60 * CLOCK_SECOND)
+#endif
+/*---------------------------------------------------------------------------*/
+PROCESS_NAME(spool_process);
+
+extern struct sink spool_sink;
+/*---------------------------------------------------------------------------*/
+#endif /* SPOOL_H_ */
+/*---------------------------------------------------------------------------*/
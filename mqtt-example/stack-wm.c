@@ -0,0 +1,66 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Run-time stack watermark, see stack-wm.h
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "stack-wm.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+#if CONTIKI_TARGET_SRF06_CC26XX
+/*
+ * From the CC26xx linker script: the stack grows down from the top of SRAM
+ * (_estack) and can use everything above the end of .bss (_ebss).
+ */
+extern uint8_t _ebss;
+extern uint8_t _estack;
+
+#define STACK_WM_BOTTOM   (&_ebss)
+#define STACK_WM_TOP      (&_estack)
+#endif
+/*---------------------------------------------------------------------------*/
+#define STACK_WM_PATTERN  0xA5
+
+/* Don't paint over the frames that are live while we paint */
+#define STACK_WM_MARGIN   32
+/*---------------------------------------------------------------------------*/
+void
+stack_wm_init(void)
+{
+#ifdef STACK_WM_BOTTOM
+  volatile uint8_t marker;
+  uint8_t *p;
+
+  for(p = STACK_WM_BOTTOM; p < (uint8_t *)&marker - STACK_WM_MARGIN; p++) {
+    *p = STACK_WM_PATTERN;
+  }
+#endif
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+stack_wm_max_used(void)
+{
+#ifdef STACK_WM_BOTTOM
+  const uint8_t *p = STACK_WM_BOTTOM;
+
+  while(p < STACK_WM_TOP && *p == STACK_WM_PATTERN) {
+    p++;
+  }
+  return (uint16_t)(STACK_WM_TOP - p);
+#else
+  return 0;
+#endif
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+stack_wm_size(void)
+{
+#ifdef STACK_WM_BOTTOM
+  return (uint16_t)(STACK_WM_TOP - STACK_WM_BOTTOM);
+#else
+  return 0;
+#endif
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,34 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Run-time stack watermark ("stack painting").
+ *
+ *     stack_wm_init() fills the unused part of the stack with a known pattern
+ *     early at boot. stack_wm_max_used() later scans for the deepest byte
+ *     that was overwritten, which is the worst case the stack has seen so far.
+ *     Only supported on targets whose linker script exports the stack bounds
+ *     (CC26xx); elsewhere both functions report 0.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef STACK_WM_H_
+#define STACK_WM_H_
+/*---------------------------------------------------------------------------*/
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Paint the free stack. Call once, as early as possible
+ */
+void stack_wm_init(void);
+
+/**
+ * \brief Highest stack usage observed since stack_wm_init(), in bytes
+ */
+uint16_t stack_wm_max_used(void);
+
+/**
+ * \brief Total space available to the stack, in bytes
+ */
+uint16_t stack_wm_size(void);
+/*---------------------------------------------------------------------------*/
+#endif /* STACK_WM_H_ */
+/*---------------------------------------------------------------------------*/
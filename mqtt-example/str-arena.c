@@ -0,0 +1,64 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Bump allocator for identity and configuration strings, see str-arena.h
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "str-arena.h"
+
+#include <stdint.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+static char arena[STR_ARENA_SIZE];
+static uint16_t used;
+/*---------------------------------------------------------------------------*/
+void
+str_arena_reset(void)
+{
+  used = 0;
+}
+/*---------------------------------------------------------------------------*/
+char *
+str_arena_strndup(const char *s, uint16_t len)
+{
+  char *copy;
+
+  if(len >= STR_ARENA_SIZE - used) {
+    return NULL;
+  }
+
+  copy = &arena[used];
+  memcpy(copy, s, len);
+  copy[len] = '\0';
+  used += len + 1;
+
+  return copy;
+}
+/*---------------------------------------------------------------------------*/
+char *
+str_arena_strdup(const char *s)
+{
+  return str_arena_strndup(s, strlen(s));
+}
+/*---------------------------------------------------------------------------*/
+str_arena_mark_t
+str_arena_mark(void)
+{
+  return used;
+}
+/*---------------------------------------------------------------------------*/
+void
+str_arena_release(str_arena_mark_t mark)
+{
+  if(mark < used) {
+    used = mark;
+  }
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+str_arena_used(void)
+{
+  return used;
+}
+/*---------------------------------------------------------------------------*/
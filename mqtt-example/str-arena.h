@@ -0,0 +1,61 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     A bump allocator for the client's identity and configuration strings.
+ *
+ *     Strings are copied in at their actual length instead of each one
+ *     reserving a worst-case BUFFER_SIZE array. Nothing is freed
+ *     individually: str_arena_mark() / str_arena_release() roll the arena
+ *     back to an earlier point, which is how a new configuration replaces
+ *     the strings built from the old one.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef STR_ARENA_H_
+#define STR_ARENA_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+#ifdef STR_ARENA_CONF_SIZE
+#define STR_ARENA_SIZE STR_ARENA_CONF_SIZE
+#else
+#define STR_ARENA_SIZE 96
+#endif
+/*---------------------------------------------------------------------------*/
+typedef uint16_t str_arena_mark_t;
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Drop every string in the arena
+ */
+void str_arena_reset(void);
+
+/**
+ * \brief Copy a string into the arena
+ * \return The copy, or NULL if the arena is full
+ */
+char *str_arena_strdup(const char *s);
+
+/**
+ * \brief Copy len bytes of s into the arena and NUL-terminate them
+ * \return The copy, or NULL if the arena is full
+ */
+char *str_arena_strndup(const char *s, uint16_t len);
+
+/**
+ * \brief Current fill level, to be handed to str_arena_release()
+ */
+str_arena_mark_t str_arena_mark(void);
+
+/**
+ * \brief Drop every string added after the mark was taken
+ */
+void str_arena_release(str_arena_mark_t mark);
+
+/**
+ * \brief Bytes in use
+ */
+uint16_t str_arena_used(void);
+/*---------------------------------------------------------------------------*/
+#endif /* STR_ARENA_H_ */
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+### RAM/flash footprint report from a GNU ld map file.
+###
+### Breaks the .text (code and read-only data), .data and .bss output
+### sections down per object file and per symbol. With --baseline the report
+### shows the difference against a previous run saved with --save, so the
+### effect of a change on RAM can be tracked build by build.
+###
+###   footprint.py mqtt-example-srf06-cc26xx.map
+###   footprint.py mqtt-example-srf06-cc26xx.map --save footprint.json
+###   footprint.py mqtt-example-srf06-cc26xx.map --baseline footprint.json
+
+import argparse
+import json
+import re
+import sys
+from collections import defaultdict
+
+SECTIONS = (".text", ".data", ".bss")
+
+# " .bss.conf      0x20000290       0x70 mqtt-example.co", possibly wrapped
+# after the input section name when the name is long
+INPUT_RE = re.compile(r"^ (\S+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$")
+NAME_ONLY_RE = re.compile(r"^ (\S+)$")
+WRAPPED_RE = re.compile(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$")
+OUTPUT_RE = re.compile(r"^(\.\S+)")
+
+
+def object_name(obj):
+    """'contiki-srf06-cc26xx.a(mqtt.o)' -> 'mqtt.o'"""
+    m = re.match(r".*\((.*)\)$", obj)
+    obj = m.group(1) if m else obj
+    return obj.split("/")[-1]
+
+
+def symbol_name(section, input_name):
+    """'.bss.conf' in '.bss' -> 'conf'; 'COMMON' is kept as is"""
+    if input_name == "COMMON":
+        return input_name
+    for prefix in (section + ".", ".rodata.", ".text."):
+        if input_name.startswith(prefix):
+            return input_name[len(prefix):]
+    return ""
+
+
+def parse_map(path):
+    """Returns {(section, object, symbol): size}"""
+    sizes = defaultdict(int)
+    section = None
+    pending = None
+    in_map = False
+
+    with open(path) as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if line.startswith("Linker script and memory map"):
+                in_map = True
+                continue
+            if not in_map:
+                continue
+
+            m = OUTPUT_RE.match(line)
+            if m:
+                section = m.group(1) if m.group(1) in SECTIONS else None
+                pending = None
+                continue
+            if section is None:
+                continue
+
+            m = INPUT_RE.match(line)
+            if m:
+                name, size, obj = m.group(1), int(m.group(3), 16), m.group(4)
+            else:
+                m = NAME_ONLY_RE.match(line)
+                if m:
+                    pending = m.group(1)
+                    continue
+                m = WRAPPED_RE.match(line)
+                if m and pending is not None:
+                    name, size, obj = pending, int(m.group(2), 16), m.group(3)
+                else:
+                    continue
+            pending = None
+
+            if size == 0 or obj.startswith("load address"):
+                continue
+            key = (section, object_name(obj), symbol_name(section, name))
+            sizes[key] += size
+
+    return dict(sizes)
+
+
+def totals(sizes, index):
+    out = defaultdict(lambda: dict.fromkeys(SECTIONS, 0))
+    for key, size in sizes.items():
+        name = key[index] if index == 1 else "%s:%s" % (key[1], key[2] or "?")
+        out[name][key[0]] += size
+    return out
+
+
+def section_sums(sizes):
+    out = dict.fromkeys(SECTIONS, 0)
+    for (sec, _, _), size in sizes.items():
+        out[sec] += size
+    return out
+
+
+def fmt_delta(cur, base):
+    if base is None:
+        return ""
+    d = cur - base
+    return "%+7d" % d if d else "%7s" % ""
+
+
+def print_table(title, cur, base, limit):
+    print("\n%s" % title)
+    print("%-40s %7s %7s %7s %7s %7s" %
+          ("", "text", "data", "bss", "flash", "ram") +
+          ("   d_flash   d_ram" if base is not None else ""))
+
+    def flash(t):
+        return t[".text"] + t[".data"]
+
+    def ram(t):
+        return t[".data"] + t[".bss"]
+
+    names = set(cur) | set(base or {})
+    empty = dict.fromkeys(SECTIONS, 0)
+    rows = sorted(names, key=lambda n: -(ram(cur.get(n, empty)) +
+                                         flash(cur.get(n, empty))))
+    for name in rows[:limit]:
+        t = cur.get(name, empty)
+        b = base.get(name, empty) if base is not None else None
+        print("%-40s %7d %7d %7d %7d %7d" %
+              (name[:40], t[".text"], t[".data"], t[".bss"], flash(t),
+               ram(t)) +
+              ("   %s %s" % (fmt_delta(flash(t), flash(b)),
+                             fmt_delta(ram(t), ram(b))) if b else ""))
+
+
+def main():
+    p = argparse.ArgumentParser(description="RAM/flash footprint report")
+    p.add_argument("map", help="linker map file")
+    p.add_argument("--baseline", help="JSON saved by a previous --save")
+    p.add_argument("--save", help="write this build's footprint as JSON")
+    p.add_argument("--object", action="append", default=[],
+                   help="only list symbols of this object (repeatable)")
+    p.add_argument("--limit", type=int, default=25,
+                   help="rows per table (default 25)")
+    args = p.parse_args()
+
+    sizes = parse_map(args.map)
+    if not sizes:
+        sys.exit("%s: no .text/.data/.bss input sections found" % args.map)
+
+    base = None
+    if args.baseline:
+        with open(args.baseline) as f:
+            base = {tuple(k.split("|")): v for k, v in json.load(f).items()}
+
+    def by(index, s):
+        return totals(s, index) if s is not None else None
+
+    flt = set(args.object)
+    sym = {k: v for k, v in sizes.items() if not flt or k[1] in flt}
+    sym_base = ({k: v for k, v in base.items() if not flt or k[1] in flt}
+                if base is not None else None)
+
+    all_sum = section_sums(sizes)
+    print("Total: text %d, data %d, bss %d -> flash %d, ram %d" %
+          (all_sum[".text"], all_sum[".data"], all_sum[".bss"],
+           all_sum[".text"] + all_sum[".data"],
+           all_sum[".data"] + all_sum[".bss"]))
+    if base is not None:
+        bt = section_sums(base)
+        print("Delta: flash %+d, ram %+d" %
+              (all_sum[".text"] + all_sum[".data"] - bt[".text"] - bt[".data"],
+               all_sum[".data"] + all_sum[".bss"] - bt[".data"] - bt[".bss"]))
+
+    print_table("Per object", by(1, sizes), by(1, base), args.limit)
+    print_table("Per symbol", by(2, sym), by(2, sym_base), args.limit)
+
+    if args.save:
+        with open(args.save, "w") as f:
+            json.dump({"|".join(k): v for k, v in sorted(sizes.items())}, f,
+                      indent=1)
+
+
+if __name__ == "__main__":
+    main()
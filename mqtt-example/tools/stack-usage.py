@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+### Static worst-case stack analysis from gcc -fstack-usage output.
+###
+### Reads the .su files written by the compiler (one line per function:
+### "file.c:line:col:function<TAB>bytes<TAB>static|dynamic|bounded"), builds
+### the call graph from the disassembly of the final image and prints, for
+### the functions of the selected source files, their own frame and the
+### deepest call chain below them. Calls through function pointers (process
+### threads, MQTT/TCP callbacks) are not followed and are listed separately.
+###
+###   stack-usage.py --elf mqtt-example.elf --objdump arm-none-eabi-objdump \
+###                  --source mqtt-example.c --source net-uart.c *.su obj_*/*.su
+
+import argparse
+import re
+import subprocess
+import sys
+
+FUNC_RE = re.compile(r"^[0-9a-f]+ <([\w.$]+)>:$")
+CALL_RE = re.compile(r"\s(bl|blx|b|b\.w|call|callq|jmp|jal)\s+[0-9a-f]+ "
+                     r"<([\w.$]+)>")
+INDIRECT_RE = re.compile(r"\s(blx\s+r\d+|call\w*\s+\*|jalr)")
+
+
+def parse_su(paths):
+    """Returns {function: (bytes, kind, source file)}"""
+    frames = {}
+    for path in paths:
+        with open(path) as f:
+            for line in f:
+                parts = line.rstrip("\n").split("\t")
+                if len(parts) != 3:
+                    continue
+                loc, size, kind = parts
+                fields = loc.split(":")
+                func = fields[-1]
+                size = int(size)
+                if func not in frames or frames[func][0] < size:
+                    frames[func] = (size, kind, fields[0].split("/")[-1])
+    return frames
+
+
+def parse_calls(objdump, elf):
+    """Returns ({caller: set(callees)}, set(callers with indirect calls))"""
+    out = subprocess.check_output([objdump, "-d", "--no-show-raw-insn", elf],
+                                  universal_newlines=True)
+    graph = {}
+    indirect = set()
+    current = None
+    for line in out.splitlines():
+        m = FUNC_RE.match(line)
+        if m:
+            current = m.group(1)
+            graph.setdefault(current, set())
+            continue
+        if current is None:
+            continue
+        m = CALL_RE.search(line)
+        if m and m.group(2) != current:
+            graph[current].add(m.group(2))
+        elif INDIRECT_RE.search(line):
+            indirect.add(current)
+    return graph, indirect
+
+
+def worst_case(func, frames, graph, memo, stack):
+    """Returns (bytes, [chain]) for the deepest call chain from func"""
+    if func in memo:
+        return memo[func]
+    own = frames.get(func, (0, "", ""))[0]
+    if func in stack:
+        # Recursion: cannot be bounded statically
+        return own, [func + " (recursive)"]
+    stack.add(func)
+    best, chain = 0, []
+    for callee in graph.get(func, ()):
+        size, sub = worst_case(callee, frames, graph, memo, stack)
+        if size > best:
+            best, chain = size, sub
+    stack.discard(func)
+    memo[func] = (own + best, [func] + chain)
+    return memo[func]
+
+
+def main():
+    p = argparse.ArgumentParser(description="Static stack usage report")
+    p.add_argument("su", nargs="+", help=".su files")
+    p.add_argument("--elf", help="linked image to extract the call graph from")
+    p.add_argument("--objdump", default="objdump")
+    p.add_argument("--source", action="append", default=[],
+                   help="report functions of this source file (repeatable)")
+    p.add_argument("--limit", type=int, default=0,
+                   help="warn if any reported chain exceeds this many bytes")
+    args = p.parse_args()
+
+    frames = parse_su(args.su)
+    if not frames:
+        sys.exit("No stack usage records found")
+
+    graph, indirect = {}, set()
+    if args.elf:
+        graph, indirect = parse_calls(args.objdump, args.elf)
+
+    memo = {}
+    sources = set(args.source)
+    funcs = sorted((f for f in frames if not sources or
+                    frames[f][2] in sources),
+                   key=lambda f: -worst_case(f, frames, graph, memo, set())[0])
+
+    print("%-32s %6s %-8s %7s  %s" % ("function", "frame", "kind", "worst",
+                                      "deepest chain"))
+    over = 0
+    for func in funcs:
+        size, kind, _ = frames[func]
+        total, chain = worst_case(func, frames, graph, memo, set())
+        flag = "*" if func in indirect else " "
+        print("%-32s %6d %-8s %7d%s %s" % (func, size, kind, total, flag,
+                                           " > ".join(chain[1:])))
+        if args.limit and total > args.limit:
+            over += 1
+
+    print("\n* also calls through a function pointer; not included above")
+    dynamic = [f for f in funcs if frames[f][1] != "static"]
+    if dynamic:
+        print("Dynamic/bounded frames (alloca/VLA): %s" % ", ".join(dynamic))
+    if over:
+        sys.exit("%d function(s) exceed the %d byte limit" % (over, args.limit))
+
+
+if __name__ == "__main__":
+    main()
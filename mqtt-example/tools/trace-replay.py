@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+### Replays a trace captured on a node (make TRACE=1, see trace.h) against
+### vtime/vtime and compares what was published then and now.
+###
+### The U records of the capture, the UART lines, are sent to the
+### application at their recorded times, or --speed times faster; the P
+### records of the replay are then compared with the captured ones: rows,
+### publishes and bytes per topic, the gaps between publishes, how late
+### each row went out compared with the capture, and the first publish that
+### differs. The exit status is 1 if a topic got more or fewer rows than in
+### the capture, by more than the tolerance.
+###
+###   trace-replay.py node.log
+###   trace-replay.py node.log --speed 10 --save fast.tr -- --rtt 400
+###   trace-replay.py node.log --against fast.tr --speed 10
+###
+### Anything after "--" goes to vtime, e.g. outages with --fail-every. The
+### node's log may hold anything else too, only the records are read. A
+### node that rebooted within the capture carries on from where it was.
+
+import argparse
+import collections
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+RECORD = re.compile(r"\bTR (\d+) ([UP]) (.*?)\s*$")
+VTIME = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                     "..", "vtime", "vtime")
+
+Publish = collections.namedtuple("Publish", "ms topic bytes rows qos")
+
+
+def load(path):
+    """U lines as (ms, text) and publishes, in time order"""
+    lines, pubs = [], []
+    offset = last = 0
+    with open(path, errors="replace") as f:
+        for text in f:
+            m = RECORD.search(text)
+            if m is None:
+                continue
+            ms = int(m.group(1))
+            if ms + offset < last:
+                # Rebooted: the clock starts over
+                offset = last
+            ms += offset
+            last = ms
+            if m.group(2) == "U":
+                lines.append((ms, m.group(3)))
+                continue
+            fields = m.group(3).split()
+            if len(fields) != 4:
+                continue
+            pubs.append(Publish(ms, fields[0], *map(int, fields[1:])))
+    return lines, pubs
+
+
+def replay(vtime, lines, speed, save, vtime_args):
+    with tempfile.NamedTemporaryFile("w", suffix=".tr", delete=False) as f:
+        for ms, text in lines:
+            f.write("TR %d U %s\n" % (ms, text))
+        capture = f.name
+    try:
+        cmd = [vtime, "--replay", capture, "--speed", str(speed),
+               "--trace-out", save] + vtime_args
+        print("$ " + " ".join(cmd))
+        subprocess.run(cmd, check=True)
+    finally:
+        os.unlink(capture)
+    return load(save)
+
+
+def percentile(values, p):
+    """Nearest rank, as vtime reports them"""
+    if not values:
+        return 0
+    values = sorted(values)
+    return values[max(0, (len(values) * p + 99) // 100 - 1)]
+
+
+def gaps(pubs):
+    """Between publishes with rows: heartbeats would hide the stalls"""
+    pubs = [p for p in pubs if p.rows]
+    return [b.ms - a.ms for a, b in zip(pubs, pubs[1:])]
+
+
+def row_times(pubs):
+    """When each row went out, in order"""
+    return [p.ms for p in pubs for _ in range(p.rows)]
+
+
+def per_topic(pubs):
+    t = collections.defaultdict(lambda: [0, 0, 0])
+    for p in pubs:
+        t[p.topic][0] += 1
+        t[p.topic][1] += p.rows
+        t[p.topic][2] += p.bytes
+    return t
+
+
+def change(b, c):
+    if b == c:
+        return ""
+    return "%+9.1f%%" % ((c - b) * 100.0 / b) if b else "%+10g" % (c - b)
+
+
+def compare(capture, run, speed, tolerance):
+    (c_lines, c_pubs), (r_lines, r_pubs) = capture, run
+    # Capture times in the replay's time
+    c_pubs = [p._replace(ms=p.ms / speed) for p in c_pubs]
+
+    print("\nUART lines: %d captured, %d replayed" %
+          (len(c_lines), len(r_lines)))
+    print("%-28s %10s %10s %10s" % ("", "capture", "replay", "change"))
+
+    worse = []
+    c_topics, r_topics = per_topic(c_pubs), per_topic(r_pubs)
+    for topic in sorted(set(c_topics) | set(r_topics)):
+        c, r = c_topics[topic], r_topics[topic]
+        for i, what in enumerate(("publishes", "rows", "bytes")):
+            print("%-28s %10d %10d %10s" %
+                  ("%s %s" % (topic, what), c[i], r[i], change(c[i], r[i])))
+        if abs(r[1] - c[1]) > c[1] * tolerance / 100.0:
+            worse.append(topic)
+
+    for name, p in (("p50", 50), ("p95", 95), ("max", 100)):
+        c, r = percentile(gaps(c_pubs), p), percentile(gaps(r_pubs), p)
+        print("%-28s %10.0f %10.0f %10s" %
+              ("gap between publishes " + name, c, r, change(c, r)))
+
+    # Row k went out lag ms later in the replay than in the capture
+    lag = [r - c for c, r in zip(row_times(c_pubs), row_times(r_pubs))]
+    if lag:
+        print("Row lag, replay - capture: p50 %.0f, p95 %.0f, max %.0f, "
+              "min %.0f ms" % (percentile(lag, 50), percentile(lag, 95),
+                               max(lag), min(lag)))
+
+    for i, (c, r) in enumerate(zip(c_pubs, r_pubs)):
+        if (c.topic, c.rows) != (r.topic, r.rows):
+            print("First different publish, #%d:\n  capture %.0f ms %s "
+                  "%d rows\n  replay  %.0f ms %s %d rows" %
+                  (i, c.ms, c.topic, c.rows, r.ms, r.topic, r.rows))
+            break
+    else:
+        if len(c_pubs) != len(r_pubs):
+            print("Same publishes, up to #%d" % min(len(c_pubs), len(r_pubs)))
+
+    if worse:
+        print("\nRows differ from the capture by more than %g%%: %s" %
+              (tolerance, ", ".join(worse)))
+        return 1
+    print("\nSame rows per topic as the capture")
+    return 0
+
+
+def main():
+    p = argparse.ArgumentParser(
+        description="Replay a node trace against vtime and compare",
+        usage="%(prog)s [options] capture [-- vtime options]")
+    p.add_argument("capture", help="log or trace with the node's TR records")
+    p.add_argument("--speed", type=float, default=1,
+                   help="replay this many times faster (default 1)")
+    p.add_argument("--save", default="trace-replay.tr",
+                   help="trace of the replay (default trace-replay.tr)")
+    p.add_argument("--against", metavar="TRACE",
+                   help="compare with this trace instead of running vtime")
+    p.add_argument("--vtime", default=VTIME, help="vtime binary")
+    p.add_argument("--tolerance", type=float, default=5,
+                   help="percent the rows of a topic may differ (default 5)")
+    # argparse would take vtime's options for ours
+    argv, vtime_args = sys.argv[1:], []
+    if "--" in argv:
+        i = argv.index("--")
+        argv, vtime_args = argv[:i], argv[i + 1:]
+    args = p.parse_args(argv)
+
+    if args.speed <= 0:
+        sys.exit("--speed must be positive")
+
+    capture = load(args.capture)
+    if not capture[0]:
+        sys.exit("No U records in %s" % args.capture)
+    if args.against:
+        run = load(args.against)
+    else:
+        run = replay(args.vtime, capture[0], args.speed, args.save,
+                     vtime_args)
+    sys.exit(compare(capture, run, args.speed, args.tolerance))
+
+
+if __name__ == "__main__":
+    main()
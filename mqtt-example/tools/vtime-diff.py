@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+### Compares two runs of vtime/vtime saved with --json.
+###
+### The simulation is deterministic for a given seed, so any difference
+### comes from the code. Every metric is listed with its change; the ones
+### that got worse by more than the tolerance are flagged and make the exit
+### status 1.
+###
+###   vtime-diff.py vtime/vtime-baseline.json vtime/vtime-run.json
+###   vtime-diff.py old.json new.json --tolerance 10
+
+import argparse
+import json
+import sys
+
+# Which way is worse. Anything else is only reported
+HIGHER_IS_WORSE = (
+    "duplicates", "lost_in_flight", "connect_failures", "drops", "pings",
+    "recovery_mean_ms", "recovery_max_ms",
+    "state_registered_pct", "state_connecting_pct", "state_connected_pct",
+    "state_disconnected_pct", "state_error_pct", "state_config_error_pct",
+)
+HIGHER_IS_WORSE_SUFFIX = ("_ms",)
+LOWER_IS_WORSE = ("lines_delivered", "state_publishing_pct")
+
+
+def worse(name, base, cur, tolerance):
+    if name in LOWER_IS_WORSE:
+        sign = -1
+    elif name in HIGHER_IS_WORSE or name.endswith(HIGHER_IS_WORSE_SUFFIX):
+        sign = 1
+    else:
+        return False
+    d = (cur - base) * sign
+    # Small counts: one more drop out of zero is not "infinitely" worse
+    return d > max(abs(base) * tolerance / 100.0, 1 if sign > 0 else 0)
+
+
+def main():
+    p = argparse.ArgumentParser(description="Compare two vtime runs")
+    p.add_argument("baseline", help="JSON of the reference run")
+    p.add_argument("run", help="JSON of the run to check")
+    p.add_argument("--tolerance", type=float, default=5,
+                   help="percent a metric may get worse (default 5)")
+    args = p.parse_args()
+
+    with open(args.baseline) as f:
+        base = json.load(f)
+    with open(args.run) as f:
+        cur = json.load(f)
+
+    for key in ("hours", "seed"):
+        if base.get(key) != cur.get(key):
+            sys.exit("Different scenarios: %s %s vs %s" %
+                     (key, base.get(key), cur.get(key)))
+
+    regressions = []
+    print("%-28s %12s %12s %10s" % ("", "baseline", "run", "change"))
+    for name in sorted(set(base) | set(cur)):
+        b, c = base.get(name), cur.get(name)
+        if b is None or c is None:
+            print("%-28s %12s %12s" % (name, b, c))
+            continue
+        change = "%+9.1f%%" % ((c - b) * 100.0 / b) if b else (
+            "%+10g" % (c - b) if c != b else "")
+        flag = worse(name, b, c, args.tolerance)
+        if flag:
+            regressions.append(name)
+        print("%-28s %12g %12g %10s%s" %
+              (name, b, c, change if c != b else "", "  WORSE" if flag else ""))
+
+    if regressions:
+        print("\n%d metric(s) worse than the baseline by more than %g%%: %s" %
+              (len(regressions), args.tolerance, ", ".join(regressions)))
+        sys.exit(1)
+    print("\nNo regression against %s" % args.baseline)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,38 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Capture of UART lines and publishes, see trace.h
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+#include "trace.h"
+#include "sys/clock.h"
+
+#include <stdint.h>
+#include <stdio.h>
+/*---------------------------------------------------------------------------*/
+/*
+ * ms since boot. Seconds and ticks apart, so a 32-bit unsigned long lasts
+ * 49 days and not the 9 hours of ticks * 1000
+ */
+static unsigned long
+now_ms(void)
+{
+  clock_time_t t = clock_time();
+
+  return (unsigned long)(t / CLOCK_SECOND) * 1000 +
+    (unsigned long)(t % CLOCK_SECOND) * 1000 / CLOCK_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+void
+trace_line(const char *text)
+{
+  printf("TR %lu U %s\n", now_ms(), text);
+}
+/*---------------------------------------------------------------------------*/
+void
+trace_publish(const char *topic, uint16_t len, uint16_t rows, uint8_t qos)
+{
+  printf("TR %lu P %s %u %u %u\n", now_ms(), topic, len, rows, qos);
+}
+/*---------------------------------------------------------------------------*/
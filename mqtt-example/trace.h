@@ -0,0 +1,38 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Capture of what goes in and out of the node, for replay on the host.
+ *
+ *     With DEFAULT_TRACE on, every UART line, valid or not, and every
+ *     publish handed to apps/mqtt print one record on the console, with
+ *     the ms since boot:
+ *
+ *       TR <ms> U <line as received>
+ *       TR <ms> P <topic> <payload bytes> <rows> <qos>
+ *
+ *     where rows is the number of queued lines the publish carried. The
+ *     records can be picked out of any log, Cooja's included;
+ *     tools/trace-replay.py feeds the U records back to vtime/ and compares
+ *     the P records it gets with the captured ones.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef TRACE_H_
+#define TRACE_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Record a line as it came from the UART
+ */
+void trace_line(const char *text);
+
+/**
+ * \brief Record a publish that apps/mqtt accepted
+ */
+void trace_publish(const char *topic, uint16_t len, uint16_t rows,
+                   uint8_t qos);
+/*---------------------------------------------------------------------------*/
+#endif /* TRACE_H_ */
+/*---------------------------------------------------------------------------*/
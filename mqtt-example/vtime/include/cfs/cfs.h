@@ -0,0 +1,2 @@
+/* Everything is declared in the one host stand-in */
+#include "contiki.h"
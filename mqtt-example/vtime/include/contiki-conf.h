@@ -0,0 +1,17 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Host stand-in: the project configuration, then the Contiki API
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef VT_CONTIKI_CONF_H_
+#define VT_CONTIKI_CONF_H_
+/*---------------------------------------------------------------------------*/
+#ifdef PROJECT_CONF_H
+#include PROJECT_CONF_H
+#endif
+
+#include "contiki.h"
+/*---------------------------------------------------------------------------*/
+#endif /* VT_CONTIKI_CONF_H_ */
+/*---------------------------------------------------------------------------*/
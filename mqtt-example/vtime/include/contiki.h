@@ -0,0 +1,219 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Host stand-ins for the parts of Contiki that mqtt-example.c uses.
+ *
+ *     Protothreads and processes are the real lc-switch ones. Time only
+ *     moves when the harness says so (vt-contiki.c), so hours of timers
+ *     run in milliseconds.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef VT_CONTIKI_H_
+#define VT_CONTIKI_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+
+#include <stdint.h>
+#include <stddef.h>
+/*---------------------------------------------------------------------------*/
+/* Clock: as on the CC26xx */
+typedef unsigned long clock_time_t;
+#define CLOCK_SECOND 128
+
+clock_time_t clock_time(void);
+unsigned long clock_seconds(void);
+/*---------------------------------------------------------------------------*/
+/* Protothreads */
+struct pt {
+  unsigned short lc;
+};
+
+#define PT_WAITING 0
+#define PT_YIELDED 1
+#define PT_EXITED  2
+#define PT_ENDED   3
+
+#define PT_THREAD(name_args) char name_args
+#define PT_BEGIN(pt) { char PT_YIELD_FLAG = 1; if(PT_YIELD_FLAG) {;} \
+  switch((pt)->lc) { case 0:
+#define PT_END(pt) } PT_YIELD_FLAG = 0; (pt)->lc = 0; return PT_ENDED; }
+/* The case labels of a protothread are meant to be fallen into */
+#define PT_FALLTHROUGH __attribute__((fallthrough))
+#define PT_YIELD(pt) do { PT_YIELD_FLAG = 0; (pt)->lc = __LINE__; \
+  PT_FALLTHROUGH; \
+  case __LINE__: if(PT_YIELD_FLAG == 0) { return PT_YIELDED; } } while(0)
+#define PT_YIELD_UNTIL(pt, cond) do { PT_YIELD_FLAG = 0; (pt)->lc = __LINE__; \
+  PT_FALLTHROUGH; \
+  case __LINE__: if((PT_YIELD_FLAG == 0) || !(cond)) { return PT_YIELDED; } \
+  } while(0)
+#define PT_WAIT_UNTIL(pt, cond) do { (pt)->lc = __LINE__; \
+  PT_FALLTHROUGH; \
+  case __LINE__: if(!(cond)) { return PT_WAITING; } } while(0)
+#define PT_EXIT(pt) do { (pt)->lc = 0; return PT_EXITED; } while(0)
+/*---------------------------------------------------------------------------*/
+/* Processes */
+typedef unsigned char process_event_t;
+typedef void *process_data_t;
+
+struct process {
+  struct process *next;
+  const char *name;
+  PT_THREAD((*thread)(struct pt *, process_event_t, process_data_t));
+  struct pt pt;
+  unsigned char state, needspoll;
+};
+
+#define PROCESS_EVENT_NONE     0x80
+#define PROCESS_EVENT_INIT     0x81
+#define PROCESS_EVENT_POLL     0x82
+#define PROCESS_EVENT_EXIT     0x83
+#define PROCESS_EVENT_CONTINUE 0x85
+#define PROCESS_EVENT_MSG      0x86
+#define PROCESS_EVENT_TIMER    0x88
+
+#define PROCESS_THREAD(name, ev, data) \
+  static PT_THREAD(process_thread_##name(struct pt *process_pt, \
+                                         process_event_t ev, \
+                                         process_data_t data))
+#define PROCESS_NAME(name) extern struct process name
+#define PROCESS(name, strname) \
+  PROCESS_THREAD(name, ev, data); \
+  struct process name = { NULL, strname, process_thread_##name, { 0 }, 0, 0 }
+
+#define PROCESS_BEGIN()             PT_BEGIN(process_pt)
+#define PROCESS_END()               PT_END(process_pt)
+#define PROCESS_YIELD()             PT_YIELD(process_pt)
+#define PROCESS_YIELD_UNTIL(c)      PT_YIELD_UNTIL(process_pt, c)
+#define PROCESS_WAIT_EVENT()        PROCESS_YIELD()
+#define PROCESS_WAIT_EVENT_UNTIL(c) PROCESS_YIELD_UNTIL(c)
+#define PROCESS_WAIT_UNTIL(c)       PT_WAIT_UNTIL(process_pt, c)
+#define PROCESS_EXIT()              PT_EXIT(process_pt)
+#define PROCESS_PAUSE() do { \
+    process_post(PROCESS_CURRENT(), PROCESS_EVENT_CONTINUE, NULL); \
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_CONTINUE); \
+  } while(0)
+
+extern struct process *process_current;
+#define PROCESS_CURRENT() process_current
+
+#define AUTOSTART_PROCESSES(...) \
+  struct process * const autostart_processes[] = { __VA_ARGS__, NULL }
+
+void process_start(struct process *p, process_data_t data);
+int process_post(struct process *p, process_event_t ev, process_data_t data);
+void process_post_synch(struct process *p, process_event_t ev,
+                        process_data_t data);
+void process_poll(struct process *p);
+process_event_t process_alloc_event(void);
+/*---------------------------------------------------------------------------*/
+/* Timers */
+struct timer {
+  clock_time_t start, interval;
+};
+
+void timer_set(struct timer *t, clock_time_t interval);
+void timer_reset(struct timer *t);
+void timer_restart(struct timer *t);
+int timer_expired(struct timer *t);
+clock_time_t timer_remaining(struct timer *t);
+
+struct etimer {
+  struct timer timer;
+  struct etimer *next;
+  struct process *p;
+};
+
+void etimer_set(struct etimer *et, clock_time_t interval);
+void etimer_reset(struct etimer *et);
+void etimer_restart(struct etimer *et);
+void etimer_stop(struct etimer *et);
+int etimer_expired(struct etimer *et);
+
+struct ctimer {
+  struct ctimer *next;
+  struct etimer etimer;
+  struct process *p;
+  void (*f)(void *);
+  void *ptr;
+};
+
+void ctimer_set(struct ctimer *c, clock_time_t t, void (*f)(void *),
+                void *ptr);
+void ctimer_reset(struct ctimer *c);
+void ctimer_restart(struct ctimer *c);
+void ctimer_stop(struct ctimer *c);
+int ctimer_expired(struct ctimer *c);
+/*---------------------------------------------------------------------------*/
+/* Serial line, LEDs, random numbers */
+extern process_event_t serial_line_event_message;
+int serial_line_input_byte(unsigned char c);
+
+#define LEDS_GREEN 1
+#define LEDS_RED   2
+void leds_on(unsigned char l);
+void leds_off(unsigned char l);
+
+#define RANDOM_RAND_MAX 65535U
+unsigned short random_rand(void);
+void random_init(unsigned short seed);
+/*---------------------------------------------------------------------------*/
+/* Network */
+typedef union {
+  unsigned char u8[8];
+} linkaddr_t;
+extern linkaddr_t linkaddr_node_addr;
+
+typedef union {
+  uint8_t u8[16];
+  uint16_t u16[8];
+} uip_ipaddr_t;
+typedef uip_ipaddr_t uip_ip6addr_t;
+
+typedef struct {
+  uip_ipaddr_t ipaddr;
+} uip_ds6_addr_t;
+
+#define ADDR_PREFERRED 1
+uip_ds6_addr_t *uip_ds6_get_global(int8_t state);
+
+typedef void (*uip_ds6_notification_callback)(int event, uip_ipaddr_t *route,
+                                               uip_ipaddr_t *nexthop,
+                                               int num_routes);
+struct uip_ds6_notification {
+  struct uip_ds6_notification *next;
+  uip_ds6_notification_callback callback;
+};
+
+#define UIP_DS6_NOTIFICATION_DEFRT_ADD 0
+#define UIP_DS6_NOTIFICATION_DEFRT_RM  1
+#define UIP_DS6_NOTIFICATION_ROUTE_ADD 2
+#define UIP_DS6_NOTIFICATION_ROUTE_RM  3
+void uip_ds6_notification_add(struct uip_ds6_notification *n,
+                              uip_ds6_notification_callback c);
+/*---------------------------------------------------------------------------*/
+/* CFS, kept in memory */
+#define CFS_READ   1
+#define CFS_WRITE  2
+#define CFS_APPEND 4
+
+int cfs_open(const char *name, int flags);
+void cfs_close(int fd);
+int cfs_read(int fd, void *buf, unsigned int len);
+int cfs_write(int fd, const void *buf, unsigned int len);
+int cfs_remove(const char *name);
+
+unsigned short crc16_data(const unsigned char *data, int len,
+                          unsigned short acc);
+/*---------------------------------------------------------------------------*/
+/* sys/cc.h */
+#define CC_CONCAT2(s1, s2) s1##s2
+#define CC_CONCAT(s1, s2)  CC_CONCAT2(s1, s2)
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+/*---------------------------------------------------------------------------*/
+#endif /* VT_CONTIKI_H_ */
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,133 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Host stand-in for apps/mqtt: the API, types and connection fields the
+ *     application uses. vt-mqtt.c implements it against a simulated broker
+ *     and link.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef VT_MQTT_H_
+#define VT_MQTT_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+#define MQTT_MAX_TOPIC_LENGTH 64
+/*---------------------------------------------------------------------------*/
+typedef enum {
+  MQTT_EVENT_CONNECTED,
+  MQTT_EVENT_DISCONNECTED,
+  MQTT_EVENT_SUBACK,
+  MQTT_EVENT_UNSUBACK,
+  MQTT_EVENT_PUBLISH,
+  MQTT_EVENT_PUBACK,
+
+  MQTT_EVENT_ERROR = 0x80,
+  MQTT_EVENT_PROTOCOL_ERROR,
+  MQTT_EVENT_CONNECTION_REFUSED_ERROR,
+  MQTT_EVENT_DNS_ERROR,
+  MQTT_EVENT_NOT_IMPLEMENTED_ERROR,
+} mqtt_event_t;
+
+typedef enum {
+  MQTT_STATUS_OK,
+  MQTT_STATUS_OUT_QUEUE_FULL,
+
+  MQTT_STATUS_ERROR = 0x80,
+  MQTT_STATUS_NOT_CONNECTED_ERROR,
+  MQTT_STATUS_INVALID_ARGS_ERROR,
+  MQTT_STATUS_DNS_ERROR,
+} mqtt_status_t;
+
+typedef enum {
+  MQTT_QOS_LEVEL_0,
+  MQTT_QOS_LEVEL_1,
+  MQTT_QOS_LEVEL_2,
+} mqtt_qos_level_t;
+
+typedef enum {
+  MQTT_RETAIN_OFF,
+  MQTT_RETAIN_ON,
+} mqtt_retain_t;
+
+typedef enum {
+  MQTT_CONN_STATE_ERROR,
+  MQTT_CONN_STATE_DNS_ERROR,
+  MQTT_CONN_STATE_DISCONNECTING,
+  MQTT_CONN_STATE_NOT_CONNECTED,
+  MQTT_CONN_STATE_DNS_LOOKUP,
+  MQTT_CONN_STATE_TCP_CONNECTING,
+  MQTT_CONN_STATE_TCP_CONNECTED,
+  MQTT_CONN_STATE_CONNECTING_TO_BROKER,
+  MQTT_CONN_STATE_CONNECTED_TO_BROKER,
+  MQTT_CONN_STATE_SENDING_MQTT_DISCONNECT,
+  MQTT_CONN_STATE_ABORT_IMMEDIATE,
+} mqtt_conn_state_t;
+
+enum mqtt_vhdr_conn_fields {
+  MQTT_VHDR_USERNAME_FLAG = 0x80,
+  MQTT_VHDR_PASSWORD_FLAG = 0x40,
+  MQTT_VHDR_WILL_RETAIN_FLAG = 0x20,
+  MQTT_VHDR_WILL_QOS_LEVEL_0 = 0x00,
+  MQTT_VHDR_WILL_QOS_LEVEL_1 = 0x08,
+  MQTT_VHDR_WILL_QOS_LEVEL_2 = 0x10,
+  MQTT_VHDR_WILL_FLAG = 0x04,
+  MQTT_VHDR_CLEAN_SESSION_FLAG = 0x02,
+};
+/*---------------------------------------------------------------------------*/
+struct mqtt_message {
+  uint32_t mid;
+  char topic[MQTT_MAX_TOPIC_LENGTH + 1];
+  uint8_t *payload_chunk;
+  uint16_t payload_chunk_length;
+  uint8_t first_chunk;
+  uint16_t payload_length;
+  uint16_t payload_left;
+};
+
+struct mqtt_connection;
+typedef void (*mqtt_event_callback_t)(struct mqtt_connection *m,
+                                      mqtt_event_t event, void *data);
+
+struct mqtt_connection {
+  uint8_t connect_vhdr_flags;
+  uint8_t auto_reconnect;
+  uint16_t keep_alive;
+  struct ctimer keep_alive_timer;
+  uint8_t waiting_for_pingresp;
+  mqtt_conn_state_t state;
+  mqtt_event_callback_t event_callback;
+  uint32_t out_queue_full;
+  struct process *app_process;
+  uint8_t out_buffer_sent;
+};
+/*---------------------------------------------------------------------------*/
+/* Posted to the app process once a QoS 0 PUBLISH has been sent */
+extern process_event_t mqtt_update_event;
+/*---------------------------------------------------------------------------*/
+mqtt_status_t mqtt_register(struct mqtt_connection *conn,
+                            struct process *app_process, char *client_id,
+                            mqtt_event_callback_t event_callback,
+                            uint16_t max_segment_size);
+mqtt_status_t mqtt_connect(struct mqtt_connection *conn, char *host,
+                           uint16_t port, uint16_t keep_alive);
+void mqtt_disconnect(struct mqtt_connection *conn);
+mqtt_status_t mqtt_subscribe(struct mqtt_connection *conn, uint16_t *mid,
+                             char *topic, mqtt_qos_level_t qos_level);
+mqtt_status_t mqtt_unsubscribe(struct mqtt_connection *conn, uint16_t *mid,
+                               char *topic);
+mqtt_status_t mqtt_publish(struct mqtt_connection *conn, uint16_t *mid,
+                           char *topic, uint8_t *payload,
+                           uint32_t payload_size, mqtt_qos_level_t qos_level,
+                           mqtt_retain_t retain);
+void mqtt_set_username_password(struct mqtt_connection *conn, char *username,
+                                char *password);
+
+#define mqtt_connected(conn) \
+  ((conn)->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER ? 1 : 0)
+#define mqtt_ready(conn) \
+  (!(conn)->out_queue_full && mqtt_connected((conn)))
+/*---------------------------------------------------------------------------*/
+#endif /* VT_MQTT_H_ */
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,573 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Contiki kernel services on a virtual clock, see vt.h
+ *
+ *     Processes, events and polls behave as in sys/process.c, etimers post
+ *     PROCESS_EVENT_TIMER and ctimers call their function in the context of
+ *     the process that set them. The clock only moves in vt_advance(), so a
+ *     timer never fires late and a run is the same every time.
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "vt.h"
+
+#include <stdint.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define EVENT_QUEUE_SIZE  32
+#define CFS_FILES         4
+#define CFS_FILE_SIZE     512
+#define CFS_NAME_LEN      16
+
+#define PROCESS_STATE_NONE     0
+#define PROCESS_STATE_RUNNING  1
+/*---------------------------------------------------------------------------*/
+static clock_time_t now;
+
+struct process *process_current;
+static struct process *process_list;
+static process_event_t last_event;
+
+static struct {
+  struct process *p;
+  process_event_t ev;
+  process_data_t data;
+} events[EVENT_QUEUE_SIZE];
+static uint8_t first_event;
+static uint8_t event_count;
+static uint8_t poll_requested;
+
+static struct etimer *etimers;
+static struct ctimer *ctimers;
+
+process_event_t serial_line_event_message;
+linkaddr_t linkaddr_node_addr = { { 0x00, 0x12, 0x4b, 0x00,
+                                    0x0a, 0x0b, 0x0c, 0x0d } };
+
+static uint8_t net_up;
+static uip_ds6_addr_t global_addr;
+static struct uip_ds6_notification *notifications;
+
+static unsigned long random_state;
+/*---------------------------------------------------------------------------*/
+static struct {
+  char name[CFS_NAME_LEN];
+  uint8_t data[CFS_FILE_SIZE];
+  unsigned int len;
+  unsigned int offset;
+  uint8_t open;
+} files[CFS_FILES];
+/*---------------------------------------------------------------------------*/
+clock_time_t
+clock_time(void)
+{
+  return now;
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+clock_seconds(void)
+{
+  return now / CLOCK_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+static void
+call_process(struct process *p, process_event_t ev, process_data_t data)
+{
+  struct process *caller = process_current;
+  int ret;
+
+  if(p->state != PROCESS_STATE_RUNNING) {
+    return;
+  }
+  process_current = p;
+  ret = p->thread(&p->pt, ev, data);
+  if(ret == PT_EXITED || ret == PT_ENDED) {
+    p->state = PROCESS_STATE_NONE;
+  }
+  process_current = caller;
+}
+/*---------------------------------------------------------------------------*/
+void
+process_start(struct process *p, process_data_t data)
+{
+  struct process *q;
+
+  for(q = process_list; q != NULL; q = q->next) {
+    if(q == p) {
+      return;
+    }
+  }
+  p->next = process_list;
+  process_list = p;
+  p->state = PROCESS_STATE_RUNNING;
+  p->pt.lc = 0;
+  call_process(p, PROCESS_EVENT_INIT, data);
+}
+/*---------------------------------------------------------------------------*/
+int
+process_post(struct process *p, process_event_t ev, process_data_t data)
+{
+  uint8_t i;
+
+  if(event_count == EVENT_QUEUE_SIZE) {
+    return 1;
+  }
+  i = (first_event + event_count++) % EVENT_QUEUE_SIZE;
+  events[i].p = p;
+  events[i].ev = ev;
+  events[i].data = data;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+process_post_synch(struct process *p, process_event_t ev, process_data_t data)
+{
+  call_process(p, ev, data);
+}
+/*---------------------------------------------------------------------------*/
+void
+process_poll(struct process *p)
+{
+  if(p != NULL) {
+    p->needspoll = 1;
+    poll_requested = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+process_event_t
+process_alloc_event(void)
+{
+  return last_event++;
+}
+/*---------------------------------------------------------------------------*/
+void
+vt_run(void)
+{
+  struct process *p;
+  uint8_t i;
+
+  for(;;) {
+    /* Polls first, as process_run() does */
+    while(poll_requested) {
+      poll_requested = 0;
+      for(p = process_list; p != NULL; p = p->next) {
+        if(p->needspoll) {
+          p->needspoll = 0;
+          call_process(p, PROCESS_EVENT_POLL, NULL);
+        }
+      }
+    }
+    if(event_count == 0) {
+      return;
+    }
+    i = first_event;
+    first_event = (first_event + 1) % EVENT_QUEUE_SIZE;
+    event_count--;
+    call_process(events[i].p, events[i].ev, events[i].data);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+timer_set(struct timer *t, clock_time_t interval)
+{
+  t->interval = interval;
+  t->start = now;
+}
+/*---------------------------------------------------------------------------*/
+void
+timer_reset(struct timer *t)
+{
+  t->start += t->interval;
+}
+/*---------------------------------------------------------------------------*/
+void
+timer_restart(struct timer *t)
+{
+  t->start = now;
+}
+/*---------------------------------------------------------------------------*/
+int
+timer_expired(struct timer *t)
+{
+  return now - t->start >= t->interval;
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+timer_remaining(struct timer *t)
+{
+  return t->start + t->interval - now;
+}
+/*---------------------------------------------------------------------------*/
+static void
+etimer_add(struct etimer *et)
+{
+  struct etimer *t;
+
+  et->p = process_current;
+  for(t = etimers; t != NULL; t = t->next) {
+    if(t == et) {
+      return;
+    }
+  }
+  et->next = etimers;
+  etimers = et;
+}
+/*---------------------------------------------------------------------------*/
+static void
+etimer_remove(struct etimer *et)
+{
+  struct etimer **t;
+
+  for(t = &etimers; *t != NULL; t = &(*t)->next) {
+    if(*t == et) {
+      *t = et->next;
+      break;
+    }
+  }
+  et->p = NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_set(struct etimer *et, clock_time_t interval)
+{
+  timer_set(&et->timer, interval);
+  etimer_add(et);
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_reset(struct etimer *et)
+{
+  timer_reset(&et->timer);
+  etimer_add(et);
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_restart(struct etimer *et)
+{
+  timer_restart(&et->timer);
+  etimer_add(et);
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_stop(struct etimer *et)
+{
+  etimer_remove(et);
+}
+/*---------------------------------------------------------------------------*/
+int
+etimer_expired(struct etimer *et)
+{
+  return et->p == NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+ctimer_add(struct ctimer *c)
+{
+  struct ctimer *t;
+
+  for(t = ctimers; t != NULL; t = t->next) {
+    if(t == c) {
+      return;
+    }
+  }
+  c->next = ctimers;
+  ctimers = c;
+}
+/*---------------------------------------------------------------------------*/
+void
+ctimer_set(struct ctimer *c, clock_time_t t, void (*f)(void *), void *ptr)
+{
+  c->p = process_current;
+  c->f = f;
+  c->ptr = ptr;
+  timer_set(&c->etimer.timer, t);
+  ctimer_add(c);
+}
+/*---------------------------------------------------------------------------*/
+void
+ctimer_reset(struct ctimer *c)
+{
+  timer_reset(&c->etimer.timer);
+  ctimer_add(c);
+}
+/*---------------------------------------------------------------------------*/
+void
+ctimer_restart(struct ctimer *c)
+{
+  timer_restart(&c->etimer.timer);
+  ctimer_add(c);
+}
+/*---------------------------------------------------------------------------*/
+void
+ctimer_stop(struct ctimer *c)
+{
+  struct ctimer **t;
+
+  for(t = &ctimers; *t != NULL; t = &(*t)->next) {
+    if(*t == c) {
+      *t = c->next;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+ctimer_expired(struct ctimer *c)
+{
+  struct ctimer *t;
+
+  for(t = ctimers; t != NULL; t = t->next) {
+    if(t == c) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+vt_next_timer(void)
+{
+  clock_time_t next = VT_NEVER;
+  struct etimer *et;
+  struct ctimer *c;
+
+  for(et = etimers; et != NULL; et = et->next) {
+    next = MIN(next, et->timer.start + et->timer.interval);
+  }
+  for(c = ctimers; c != NULL; c = c->next) {
+    next = MIN(next, c->etimer.timer.start + c->etimer.timer.interval);
+  }
+  return next;
+}
+/*---------------------------------------------------------------------------*/
+/* Fire the earliest timer due by now. 0 if there is none */
+static int
+fire_one(void)
+{
+  struct etimer *et, *first_et = NULL;
+  struct ctimer *c, *first_c = NULL;
+  struct process *p;
+  struct process *caller;
+
+  for(et = etimers; et != NULL; et = et->next) {
+    if(timer_expired(&et->timer) &&
+       (first_et == NULL || et->timer.start + et->timer.interval <
+        first_et->timer.start + first_et->timer.interval)) {
+      first_et = et;
+    }
+  }
+  for(c = ctimers; c != NULL; c = c->next) {
+    if(timer_expired(&c->etimer.timer) &&
+       (first_c == NULL || c->etimer.timer.start + c->etimer.timer.interval <
+        first_c->etimer.timer.start + first_c->etimer.timer.interval)) {
+      first_c = c;
+    }
+  }
+
+  if(first_c != NULL && (first_et == NULL ||
+     first_c->etimer.timer.start + first_c->etimer.timer.interval <=
+     first_et->timer.start + first_et->timer.interval)) {
+    ctimer_stop(first_c);
+    if(first_c->f != NULL) {
+      caller = process_current;
+      process_current = first_c->p;
+      first_c->f(first_c->ptr);
+      process_current = caller;
+    }
+    return 1;
+  }
+  if(first_et != NULL) {
+    p = first_et->p;
+    etimer_remove(first_et);
+    process_post(p, PROCESS_EVENT_TIMER, first_et);
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+vt_advance(clock_time_t t)
+{
+  now = t;
+  vt_run();
+  while(fire_one()) {
+    vt_run();
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+vt_init(unsigned short seed)
+{
+  now = 0;
+  process_current = NULL;
+  process_list = NULL;
+  first_event = event_count = poll_requested = 0;
+  last_event = PROCESS_EVENT_TIMER + 2;
+  etimers = NULL;
+  ctimers = NULL;
+  net_up = 0;
+  notifications = NULL;
+  memset(files, 0, sizeof(files));
+  random_init(seed);
+  serial_line_event_message = process_alloc_event();
+}
+/*---------------------------------------------------------------------------*/
+void
+vt_serial_line(struct process *p, char *line)
+{
+  process_post_synch(p, serial_line_event_message, line);
+  vt_run();
+}
+/*---------------------------------------------------------------------------*/
+uip_ds6_addr_t *
+uip_ds6_get_global(int8_t state)
+{
+  return net_up ? &global_addr : NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_ds6_notification_add(struct uip_ds6_notification *n,
+                         uip_ds6_notification_callback c)
+{
+  n->callback = c;
+  n->next = notifications;
+  notifications = n;
+}
+/*---------------------------------------------------------------------------*/
+void
+vt_net_up(void)
+{
+  struct uip_ds6_notification *n;
+
+  net_up = 1;
+  global_addr.ipaddr.u16[0] = 0x00fd;
+  memcpy(&global_addr.ipaddr.u8[8], linkaddr_node_addr.u8, 8);
+  for(n = notifications; n != NULL; n = n->next) {
+    n->callback(UIP_DS6_NOTIFICATION_DEFRT_ADD, NULL, NULL, 1);
+  }
+  vt_run();
+}
+/*---------------------------------------------------------------------------*/
+void
+leds_on(unsigned char l)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+leds_off(unsigned char l)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+random_init(unsigned short seed)
+{
+  random_state = seed;
+}
+/*---------------------------------------------------------------------------*/
+unsigned short
+random_rand(void)
+{
+  random_state = random_state * 1103515245UL + 12345;
+  return (random_state >> 16) & RANDOM_RAND_MAX;
+}
+/*---------------------------------------------------------------------------*/
+/* lib/crc16.c */
+static unsigned short
+crc16_add(unsigned char b, unsigned short acc)
+{
+  acc ^= b;
+  acc = (acc >> 8) | (acc << 8);
+  acc ^= (acc & 0xff00) << 4;
+  acc ^= (acc >> 8) >> 4;
+  acc ^= (acc & 0xff00) >> 5;
+  return acc;
+}
+/*---------------------------------------------------------------------------*/
+unsigned short
+crc16_data(const unsigned char *data, int len, unsigned short acc)
+{
+  int i;
+
+  for(i = 0; i < len; i++) {
+    acc = crc16_add(data[i], acc);
+  }
+  return acc;
+}
+/*---------------------------------------------------------------------------*/
+/* CFS: a few files in RAM, which survive as long as the harness runs */
+int
+cfs_open(const char *name, int flags)
+{
+  int fd, free_fd = -1;
+
+  for(fd = 0; fd < CFS_FILES; fd++) {
+    if(files[fd].name[0] == '\0') {
+      free_fd = free_fd < 0 ? fd : free_fd;
+    } else if(strcmp(files[fd].name, name) == 0) {
+      break;
+    }
+  }
+  if(fd == CFS_FILES) {
+    if(!(flags & (CFS_WRITE | CFS_APPEND)) || free_fd < 0 ||
+       strlen(name) >= CFS_NAME_LEN) {
+      return -1;
+    }
+    fd = free_fd;
+    strcpy(files[fd].name, name);
+  }
+  if((flags & CFS_WRITE) && !(flags & CFS_APPEND)) {
+    files[fd].len = 0;
+  }
+  files[fd].offset = flags & CFS_APPEND ? files[fd].len : 0;
+  files[fd].open = 1;
+  return fd;
+}
+/*---------------------------------------------------------------------------*/
+void
+cfs_close(int fd)
+{
+  if(fd >= 0 && fd < CFS_FILES) {
+    files[fd].open = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_read(int fd, void *buf, unsigned int len)
+{
+  if(fd < 0 || fd >= CFS_FILES || !files[fd].open) {
+    return -1;
+  }
+  len = MIN(len, files[fd].len - files[fd].offset);
+  memcpy(buf, files[fd].data + files[fd].offset, len);
+  files[fd].offset += len;
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_write(int fd, const void *buf, unsigned int len)
+{
+  if(fd < 0 || fd >= CFS_FILES || !files[fd].open) {
+    return -1;
+  }
+  len = MIN(len, CFS_FILE_SIZE - files[fd].offset);
+  memcpy(files[fd].data + files[fd].offset, buf, len);
+  files[fd].offset += len;
+  files[fd].len = MAX(files[fd].len, files[fd].offset);
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_remove(const char *name)
+{
+  int fd;
+
+  for(fd = 0; fd < CFS_FILES; fd++) {
+    if(strcmp(files[fd].name, name) == 0) {
+      memset(&files[fd], 0, sizeof(files[fd]));
+      return 0;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
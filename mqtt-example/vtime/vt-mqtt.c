@@ -0,0 +1,433 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     apps/mqtt against a simulated link and broker, see vt.h
+ *
+ *     One connection, one broker, whatever host it is given. uIP keeps a
+ *     single unacknowledged segment in flight, so a packet takes one round
+ *     trip per max_segment_size bytes to get across. Like apps/mqtt, only
+ *     one PUBLISH or SUBSCRIBE is in the out buffer at a time, and a
+ *     PINGREQ goes out whenever conn->keep_alive_timer fires; a PINGRESP
+ *     that has not come back by the next one ends the connection.
+ *
+ *     A packet sent while the link is down is retransmitted when it comes
+ *     back, unless TCP gives up first (tcp_timeout). Silence longer than
+ *     nat_idle makes the NAT forget the connection: the next packet goes
+ *     nowhere and the connection dies tcp_timeout later. Silence longer
+ *     than 1.5 keep-alive periods makes the broker close it, which the
+ *     next packet finds out.
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "mqtt.h"
+#include "vt.h"
+#include "keep-alive.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define PAYLOAD_MAX   1024
+#define ACKS          4
+
+#define PKT_NONE      0
+#define PKT_PUBLISH   1
+#define PKT_SUBSCRIBE 2
+/*---------------------------------------------------------------------------*/
+static struct vt_link link;
+static vt_deliver_t deliver;
+static struct vt_mqtt_stats stats;
+
+static struct mqtt_connection *conn;
+static uint16_t mss;
+static uint16_t keep_alive;      /* As sent in CONNECT */
+static uint8_t link_up;
+static uint8_t session;          /* The broker holds our subscription */
+
+/* What the NAT and the broker last heard from us */
+static clock_time_t last_sent;
+static uint8_t nat_lost;
+static uint8_t broker_closed;
+
+/* The out buffer, sent but not acked yet */
+static uint8_t tx_kind;
+static mqtt_qos_level_t tx_qos;
+static uint16_t tx_len;          /* On the wire */
+static uint16_t tx_payload_len;
+static char tx_topic[MQTT_MAX_TOPIC_LENGTH + 1];
+static uint8_t tx_payload[PAYLOAD_MAX];
+static uint8_t ping_pending;
+
+static struct ctimer connect_timer;
+static struct ctimer tx_timer;
+static struct ctimer pingresp_timer;
+static struct ctimer drop_timer;
+static struct ctimer ack_timer[ACKS];
+static mqtt_event_t ack_event[ACKS];
+
+static mqtt_event_t reason;
+
+process_event_t mqtt_update_event;
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+tx_time(uint16_t len)
+{
+  return (len + mss - 1) / mss * link.rtt;
+}
+/*---------------------------------------------------------------------------*/
+static void
+stop_timers(void)
+{
+  uint8_t i;
+
+  ctimer_stop(&connect_timer);
+  ctimer_stop(&tx_timer);
+  ctimer_stop(&pingresp_timer);
+  ctimer_stop(&drop_timer);
+  for(i = 0; i < ACKS; i++) {
+    ctimer_stop(&ack_timer[i]);
+  }
+  if(conn != NULL) {
+    ctimer_stop(&conn->keep_alive_timer);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+close_conn(mqtt_event_t why)
+{
+  if(conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
+    stats.drops++;
+  }
+  if(tx_kind == PKT_PUBLISH) {
+    stats.lost++;
+  }
+  stop_timers();
+  tx_kind = PKT_NONE;
+  ping_pending = 0;
+  conn->out_buffer_sent = 1;
+  conn->waiting_for_pingresp = 0;
+  conn->state = MQTT_CONN_STATE_NOT_CONNECTED;
+
+  reason = why;
+  conn->event_callback(conn, MQTT_EVENT_DISCONNECTED, &reason);
+}
+/*---------------------------------------------------------------------------*/
+static void
+drop_callback(void *ptr)
+{
+  close_conn((mqtt_event_t)(uintptr_t)ptr);
+}
+/*---------------------------------------------------------------------------*/
+static void
+ack_callback(void *ptr)
+{
+  mqtt_event_t *ev = ptr;
+
+  if(mqtt_connected(conn)) {
+    conn->event_callback(conn, *ev, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The broker answers rtt / 2 after a packet reached it */
+static void
+ack(mqtt_event_t ev)
+{
+  uint8_t i;
+
+  for(i = 0; i < ACKS && !ctimer_expired(&ack_timer[i]); i++);
+  if(i < ACKS) {
+    ack_event[i] = ev;
+    ctimer_set(&ack_timer[i], link.rtt / 2, ack_callback, &ack_event[i]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+tx_callback(void *ptr)
+{
+  conn->out_buffer_sent = 1;
+
+  if(tx_kind == PKT_PUBLISH) {
+    stats.publishes++;
+    stats.bytes += tx_len;
+    deliver(tx_topic, tx_payload, tx_payload_len);
+    if(tx_qos > MQTT_QOS_LEVEL_0) {
+      ack(MQTT_EVENT_PUBACK);
+    } else {
+      process_post(conn->app_process, mqtt_update_event, NULL);
+    }
+  } else if(tx_kind == PKT_SUBSCRIBE) {
+    stats.subscribes++;
+    session = 1;
+    ack(MQTT_EVENT_SUBACK);
+  }
+  tx_kind = PKT_NONE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+pingresp_callback(void *ptr)
+{
+  ping_pending = 0;
+  conn->waiting_for_pingresp = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Get whatever is pending across, or start counting towards giving up */
+static void
+transmit(void)
+{
+  if(broker_closed && link_up) {
+    /* The broker answers with a RST */
+    ctimer_set(&drop_timer, link.rtt, drop_callback,
+               (void *)(uintptr_t)MQTT_EVENT_ERROR);
+    return;
+  }
+  if(nat_lost || !link_up) {
+    if(ctimer_expired(&drop_timer)) {
+      ctimer_set(&drop_timer, link.tcp_timeout, drop_callback,
+                 (void *)(uintptr_t)MQTT_EVENT_ERROR);
+    }
+    return;
+  }
+  ctimer_stop(&drop_timer);
+  if(tx_kind != PKT_NONE) {
+    ctimer_set(&tx_timer, tx_time(tx_len), tx_callback, NULL);
+  }
+  if(ping_pending) {
+    ctimer_set(&pingresp_timer, link.rtt, pingresp_callback, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* A packet leaves the node */
+static void
+packet_out(void)
+{
+  clock_time_t silence = clock_time() - last_sent;
+
+  last_sent = clock_time();
+  if(link.nat_idle > 0 && silence > link.nat_idle) {
+    nat_lost = 1;
+  }
+  if(!nat_lost && silence > (clock_time_t)keep_alive * CLOCK_SECOND * 3 / 2) {
+    broker_closed = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* As in mqtt.c, and what keep-alive.c infers PINGREQs from: see there */
+static void
+keep_alive_callback(void *ptr)
+{
+  if(conn->waiting_for_pingresp) {
+    close_conn(MQTT_EVENT_ERROR);
+    return;
+  }
+
+  stats.pings++;
+  conn->waiting_for_pingresp = 1;
+  ping_pending = 1;
+  packet_out();
+  transmit();
+  ctimer_set(&conn->keep_alive_timer, conn->keep_alive * CLOCK_SECOND,
+             keep_alive_callback, conn);
+}
+/*---------------------------------------------------------------------------*/
+static void
+connect_failed_callback(void *ptr)
+{
+  stats.connect_failures++;
+  close_conn(MQTT_EVENT_ERROR);
+}
+/*---------------------------------------------------------------------------*/
+static void
+connack_callback(void *ptr)
+{
+  if(!link_up) {
+    /* SYN retransmissions until TCP gives up */
+    ctimer_set(&connect_timer, link.tcp_timeout - 2 * link.rtt,
+               connect_failed_callback, NULL);
+    return;
+  }
+
+  stats.connects++;
+  if(conn->connect_vhdr_flags & MQTT_VHDR_CLEAN_SESSION_FLAG) {
+    session = 0;
+  } else if(session) {
+    stats.resumed++;
+  }
+
+  conn->state = MQTT_CONN_STATE_CONNECTED_TO_BROKER;
+  conn->waiting_for_pingresp = 0;
+  last_sent = clock_time();
+  ctimer_set(&conn->keep_alive_timer, conn->keep_alive * CLOCK_SECOND,
+             keep_alive_callback, conn);
+  conn->event_callback(conn, MQTT_EVENT_CONNECTED, NULL);
+}
+/*---------------------------------------------------------------------------*/
+mqtt_status_t
+mqtt_register(struct mqtt_connection *c, struct process *app_process,
+              char *client_id, mqtt_event_callback_t event_callback,
+              uint16_t max_segment_size)
+{
+  conn = c;
+  memset(conn, 0, sizeof(*conn));
+  conn->app_process = app_process;
+  conn->event_callback = event_callback;
+  conn->state = MQTT_CONN_STATE_NOT_CONNECTED;
+  conn->out_buffer_sent = 1;
+  mss = max_segment_size;
+  return MQTT_STATUS_OK;
+}
+/*---------------------------------------------------------------------------*/
+mqtt_status_t
+mqtt_connect(struct mqtt_connection *c, char *host, uint16_t port,
+             uint16_t ka)
+{
+  stop_timers();
+  tx_kind = PKT_NONE;
+  ping_pending = 0;
+  nat_lost = 0;
+  broker_closed = 0;
+
+  keep_alive = ka;
+  conn->keep_alive = ka;
+  conn->connect_vhdr_flags = MQTT_VHDR_CLEAN_SESSION_FLAG;
+  conn->out_buffer_sent = 1;
+  conn->state = MQTT_CONN_STATE_TCP_CONNECTING;
+
+  /* SYN, SYN-ACK, CONNECT, CONNACK */
+  if(link_up) {
+    ctimer_set(&connect_timer, 2 * link.rtt, connack_callback, NULL);
+  } else {
+    ctimer_set(&connect_timer, link.tcp_timeout, connect_failed_callback,
+               NULL);
+  }
+  return MQTT_STATUS_OK;
+}
+/*---------------------------------------------------------------------------*/
+static void
+disconnected_callback(void *ptr)
+{
+  close_conn(MQTT_EVENT_DISCONNECTED);
+}
+/*---------------------------------------------------------------------------*/
+void
+mqtt_disconnect(struct mqtt_connection *c)
+{
+  if(c->state != MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
+    /* Nothing to say goodbye to: just abort */
+    stop_timers();
+    c->state = MQTT_CONN_STATE_NOT_CONNECTED;
+    return;
+  }
+
+  stop_timers();
+  c->state = MQTT_CONN_STATE_SENDING_MQTT_DISCONNECT;
+  ctimer_set(&drop_timer, link.rtt, disconnected_callback, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static mqtt_status_t
+send(uint8_t kind, const char *topic, uint16_t len)
+{
+  if(conn->state != MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
+    return MQTT_STATUS_NOT_CONNECTED_ERROR;
+  }
+  if(!conn->out_buffer_sent) {
+    return MQTT_STATUS_OUT_QUEUE_FULL;
+  }
+
+  tx_kind = kind;
+  tx_len = len;
+  strncpy(tx_topic, topic, MQTT_MAX_TOPIC_LENGTH);
+  conn->out_buffer_sent = 0;
+  packet_out();
+  transmit();
+  return MQTT_STATUS_OK;
+}
+/*---------------------------------------------------------------------------*/
+mqtt_status_t
+mqtt_subscribe(struct mqtt_connection *c, uint16_t *mid, char *topic,
+               mqtt_qos_level_t qos_level)
+{
+  /* Fixed header, packet ID, topic length, topic, QoS */
+  return send(PKT_SUBSCRIBE, topic, 2 + 2 + 2 + strlen(topic) + 1);
+}
+/*---------------------------------------------------------------------------*/
+mqtt_status_t
+mqtt_unsubscribe(struct mqtt_connection *c, uint16_t *mid, char *topic)
+{
+  return MQTT_STATUS_OK;
+}
+/*---------------------------------------------------------------------------*/
+mqtt_status_t
+mqtt_publish(struct mqtt_connection *c, uint16_t *mid, char *topic,
+             uint8_t *payload, uint32_t payload_size,
+             mqtt_qos_level_t qos_level, mqtt_retain_t retain)
+{
+  mqtt_status_t status;
+
+  if(payload_size > PAYLOAD_MAX) {
+    return MQTT_STATUS_INVALID_ARGS_ERROR;
+  }
+
+  /* Fixed header, topic length, topic, packet ID at QoS 1, payload */
+  status = send(PKT_PUBLISH, topic, 2 + 2 + strlen(topic) +
+                (qos_level > MQTT_QOS_LEVEL_0 ? 2 : 0) + payload_size);
+  if(status == MQTT_STATUS_OK) {
+    tx_qos = qos_level;
+    tx_payload_len = payload_size;
+    memcpy(tx_payload, payload, payload_size);
+  }
+  return status;
+}
+/*---------------------------------------------------------------------------*/
+void
+mqtt_set_username_password(struct mqtt_connection *c, char *username,
+                           char *password)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+vt_mqtt_init(const struct vt_link *l, vt_deliver_t d)
+{
+  link = *l;
+  deliver = d;
+  mqtt_update_event = process_alloc_event();
+  memset(&stats, 0, sizeof(stats));
+  conn = NULL;
+  link_up = 1;
+  session = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+vt_mqtt_link(int up)
+{
+  link_up = up;
+  if(conn == NULL || !mqtt_connected(conn)) {
+    return;
+  }
+
+  if(!up) {
+    /* Whatever was on its way is lost and will be retransmitted */
+    ctimer_stop(&tx_timer);
+    ctimer_stop(&pingresp_timer);
+  }
+  if(tx_kind != PKT_NONE || ping_pending) {
+    transmit();
+  }
+}
+/*---------------------------------------------------------------------------*/
+const struct vt_mqtt_stats *
+vt_mqtt_stats(void)
+{
+  return &stats;
+}
+/*---------------------------------------------------------------------------*/
+int
+vt_mqtt_check_pings(void)
+{
+  if(keep_alive_pings() != (uint16_t)stats.pings) {
+    fprintf(stderr, "keep-alive.c counted %u PINGREQs, %lu were sent\n",
+            keep_alive_pings(), (unsigned long)stats.pings);
+    return 0;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,98 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Virtual-time harness: what vtime.c drives in vt-contiki.c and
+ *     vt-mqtt.c.
+ *
+ *     Nothing runs by itself. The harness asks for the next deadline, moves
+ *     the clock there with vt_advance(), which fires the timers that are
+ *     due and runs the processes until they have nothing left to do, and
+ *     injects UART lines and link failures in between.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef VT_H_
+#define VT_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+#define VT_NEVER ((clock_time_t)-1)
+/*---------------------------------------------------------------------------*/
+/* vt-contiki.c */
+
+/**
+ * \brief Start the clock at 0, seed random_rand() and forget every file
+ */
+void vt_init(unsigned short seed);
+
+/**
+ * \brief Dispatch polls and queued events until there are none left
+ */
+void vt_run(void);
+
+/**
+ * \brief Expiry time of the first etimer or ctimer, VT_NEVER if none is set
+ */
+clock_time_t vt_next_timer(void);
+
+/**
+ * \brief Move the clock to t, firing every timer due by then, in order
+ */
+void vt_advance(clock_time_t t);
+
+/**
+ * \brief The node got a global address and a default route
+ */
+void vt_net_up(void);
+
+/**
+ * \brief A line arrived on the UART
+ */
+void vt_serial_line(struct process *p, char *line);
+/*---------------------------------------------------------------------------*/
+/* vt-mqtt.c */
+
+struct vt_link {
+  clock_time_t rtt;          /* Node to broker and back */
+  clock_time_t tcp_timeout;  /* Until TCP gives up on an unacked segment */
+  clock_time_t nat_idle;     /* Silence after which the NAT forgets us */
+};
+
+struct vt_mqtt_stats {
+  uint32_t connects;         /* CONNACKs */
+  uint32_t connect_failures;
+  uint32_t drops;            /* Established connections lost */
+  uint32_t resumed;          /* Connects that found the session */
+  uint32_t publishes;        /* Delivered to the broker */
+  uint32_t lost;             /* In flight when the connection died */
+  uint32_t bytes;            /* PUBLISH packets, on the wire */
+  uint32_t pings;
+  uint32_t subscribes;
+};
+
+typedef void (*vt_deliver_t)(const char *topic, const uint8_t *payload,
+                             uint16_t len);
+
+/**
+ * \brief Reset the broker and bring the link up
+ * \param deliver Called with every PUBLISH the broker receives
+ */
+void vt_mqtt_init(const struct vt_link *link, vt_deliver_t deliver);
+
+/**
+ * \brief Take the link down or bring it back
+ */
+void vt_mqtt_link(int up);
+
+const struct vt_mqtt_stats *vt_mqtt_stats(void);
+
+/**
+ * \brief Whether keep-alive.c, which infers PINGREQs from the fields of the
+ *        connection, counted every one this stand-in sent
+ * \return 1 if it did, else 0 after saying so on stderr
+ */
+int vt_mqtt_check_pings(void);
+/*---------------------------------------------------------------------------*/
+#endif /* VT_H_ */
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,657 @@
+/*---------------------------------------------------------------------------*/
+/**
+ * \file
+ *     Virtual-time run of mqtt-example.c: a day of UART lines, link outages
+ *     and idle timeouts in about a second.
+ *
+ *     The application, mqtt-example.c and the UART router that feeds it, is
+ *     compiled into this file, unchanged, so the harness can watch its state
+ *     machine and queues. Contiki and apps/mqtt are the
+ *     host stand-ins of vt-contiki.c and vt-mqtt.c. Every line carries its
+ *     number and the virtual time it was sent at; the rows the broker
+ *     receives give the delivery ratio and the UART to broker latency.
+ *
+ *       ./vtime --hours 24 --fail-every 3600 --outage 120 --json run.json
+ *
+ *     With --replay, the lines are instead the U records of a trace
+ *     captured on a node (trace.h), sent at their recorded times or --speed
+ *     times faster; --trace-out saves the records of this run to compare
+ *     against it, see tools/trace-replay.py.
+ */
+/*---------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdarg.h>
+
+int vt_app_printf(const char *fmt, ...);
+#define printf vt_app_printf
+#include "../mqtt-example.c"
+#include "../router.c"
+#include "../trace.c"
+#undef printf
+
+#include "vt.h"
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+/*---------------------------------------------------------------------------*/
+#define LINE_LEN        64
+/* Lines of a replayed trace, as long as the router takes */
+#define REPLAY_LEN      256
+/* Times in lines are ms, modulo TIME_WRAP to stay within the line parser */
+#define TIME_WRAP       10000000UL
+
+#define SECONDS(s)      ((clock_time_t)((s) * CLOCK_SECOND))
+#define TO_MS(t)        ((double)(t) * 1000 / CLOCK_SECOND)
+/*---------------------------------------------------------------------------*/
+static struct {
+  double hours;
+  double line_interval;
+  unsigned alarm_every;
+  unsigned channels;
+  double fail_every;
+  double outage;
+  double join;
+  unsigned seed;
+  int log;
+  const char *json;
+  const char *replay;
+  double speed;
+  FILE *trace;
+  struct vt_link link;
+} opt = {
+  .hours = 24,
+  .line_interval = 10,
+  .alarm_every = 0,
+  .channels = 0,
+  .fail_every = 0,
+  .outage = 120,
+  .join = 5,
+  .seed = 1,
+  .speed = 1,
+};
+/*---------------------------------------------------------------------------*/
+/* Per line: when it was sent and, once delivered, how long that took */
+static uint32_t lines_sent;
+static uint32_t lines_max;
+static uint8_t *delivered;
+static uint32_t duplicates;
+/* Rows the broker received, numbered or not */
+static uint32_t rows_received;
+
+/* The next U record of the trace being replayed */
+static FILE *replay;
+static char replay_line[REPLAY_LEN];
+static clock_time_t replay_at;
+
+struct latencies {
+  double *ms;
+  uint32_t count;
+};
+static struct latencies routine;
+static struct latencies alarms;
+
+/* Time spent in each state of the application */
+#define STATES 9
+static const uint8_t state_ids[STATES] = {
+  STATE_INIT, STATE_REGISTERED, STATE_CONNECTING, STATE_CONNECTED,
+  STATE_PUBLISHING, STATE_DISCONNECTED, STATE_NEWCONFIG, STATE_CONFIG_ERROR,
+  STATE_ERROR
+};
+static const char *const state_names[STATES] = {
+  "init", "registered", "connecting", "connected", "publishing",
+  "disconnected", "newconfig", "config_error", "error"
+};
+static clock_time_t state_time[STATES];
+
+/* Outages, and how long it took to publish again after each */
+static uint32_t outages;
+static clock_time_t down_time;
+static uint32_t recoveries;
+static clock_time_t recovery_sum;
+static clock_time_t recovery_max;
+static clock_time_t recovering_since;
+static uint8_t recovering;
+
+static uint32_t xorshift_state;
+/*---------------------------------------------------------------------------*/
+int
+vt_app_printf(const char *fmt, ...)
+{
+  static int line_start = 1;
+  char buf[256];
+  const char *p;
+  va_list ap;
+  int len;
+
+  if(!opt.log && opt.trace == NULL) {
+    return 0;
+  }
+  va_start(ap, fmt);
+  len = vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+
+  /* trace.c prints each record whole, with the virtual time already in */
+  if(opt.trace != NULL && strncmp(buf, "TR ", 3) == 0) {
+    fputs(buf, opt.trace);
+  }
+  if(!opt.log) {
+    return len;
+  }
+
+  /* Every line the application prints gets the virtual time in front */
+  for(p = buf; *p != '\0'; p++) {
+    if(line_start && *p != '\n') {
+      fprintf(stdout, "%10.3f ", TO_MS(clock_time()) / 1000);
+      line_start = 0;
+    }
+    if(*p == '\n') {
+      line_start = 1;
+    }
+    fputc(*p, stdout);
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+/* The harness has its own random numbers, apart from random_rand() */
+static double
+uniform(void)
+{
+  xorshift_state ^= xorshift_state << 13;
+  xorshift_state ^= xorshift_state >> 17;
+  xorshift_state ^= xorshift_state << 5;
+  return (double)xorshift_state / 4294967296.0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_latency(struct latencies *l, double ms)
+{
+  l->ms[l->count++] = ms;
+}
+/*---------------------------------------------------------------------------*/
+/* One row the broker received: "...,k=<line>,t=<ms>[,CO=...]" */
+static void
+delivered_row(const char *text, uint16_t len)
+{
+  char row[LINE_LEN];
+  const char *k = NULL, *t = NULL, *p;
+  unsigned long line, sent, now_ms;
+
+  len = MIN(len, LINE_LEN - 1);
+  memcpy(row, text, len);
+  row[len] = '\0';
+
+  for(p = row; p[0] != '\0' && p[1] != '\0'; p++) {
+    if((p == row || p[-1] == ',') && p[1] == '=') {
+      if(p[0] == 'k') {
+        k = p + 2;
+      } else if(p[0] == 't') {
+        t = p + 2;
+      }
+    }
+  }
+  if(k == NULL || t == NULL) {
+    return;
+  }
+
+  line = strtoul(k, NULL, 10);
+  sent = strtoul(t, NULL, 10);
+  if(line >= lines_max) {
+    return;
+  }
+  if(delivered[line]) {
+    duplicates++;
+    return;
+  }
+  delivered[line] = 1;
+
+  now_ms = (unsigned long)TO_MS(clock_time()) % TIME_WRAP;
+  add_latency(strstr(row, "CO=") != NULL ? &alarms : &routine,
+              (double)((now_ms + TIME_WRAP - sent) % TIME_WRAP));
+}
+/*---------------------------------------------------------------------------*/
+static void
+deliver(const char *topic, const uint8_t *payload, uint16_t len)
+{
+  const char *row = (const char *)payload;
+  const char *end = row + len;
+  const char *nl;
+
+  /* The first row is the "#<client>,<epoch>,<seq>" header */
+  while(row < end) {
+    nl = memchr(row, '\n', end - row);
+    nl = nl != NULL ? nl : end;
+    if(row[0] != '#') {
+      rows_received++;
+      if(replay == NULL) {
+        delivered_row(row, nl - row);
+      }
+    }
+    row = nl + 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_line(void)
+{
+  char line[LINE_LEN];
+  int len = 0;
+
+  if(opt.channels > 0) {
+    len = snprintf(line, LINE_LEN, "ch%u:", lines_sent % opt.channels);
+  }
+  len += snprintf(line + len, LINE_LEN - len, "n=1,k=%lu,t=%lu",
+                  (unsigned long)lines_sent,
+                  (unsigned long)TO_MS(clock_time()) % TIME_WRAP);
+  if(opt.alarm_every > 0 && lines_sent % opt.alarm_every ==
+     opt.alarm_every - 1) {
+    snprintf(line + len, LINE_LEN - len, ",CO=9999");
+  }
+  lines_sent++;
+  vt_serial_line(&router_process, line);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Read up to the next U record, from a trace or from any log with records
+ * in it. 0 at the end. Times never go back: a reboot within the trace
+ * only squeezes its lines together
+ */
+static int
+replay_next(void)
+{
+  char buf[REPLAY_LEN + 32];
+  unsigned long ms;
+  clock_time_t at;
+  char *p;
+  int n;
+
+  while(fgets(buf, sizeof(buf), replay) != NULL) {
+    buf[strcspn(buf, "\r\n")] = '\0';
+    p = strstr(buf, "TR ");
+    n = 0;
+    if(p == NULL || sscanf(p, "TR %lu U %n", &ms, &n) != 1 || n == 0) {
+      continue;
+    }
+    snprintf(replay_line, sizeof(replay_line), "%s", p + n);
+    at = SECONDS(ms / 1000.0 / opt.speed);
+    replay_at = MAX(replay_at, at);
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+replay_line_due(clock_time_t now)
+{
+  do {
+    lines_sent++;
+    vt_serial_line(&router_process, replay_line);
+    if(!replay_next()) {
+      return VT_NEVER;
+    }
+  } while(replay_at <= now);
+  return replay_at;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+state_index(void)
+{
+  uint8_t i;
+
+  for(i = 0; i < STATES - 1 && state_ids[i] != state; i++);
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+static int
+publishing(void)
+{
+  return state == STATE_PUBLISHING && mqtt_connected(&conn) &&
+    conn.out_buffer_sent;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(void)
+{
+  clock_time_t end = SECONDS(opt.hours * 3600);
+  clock_time_t next_line = SECONDS(opt.line_interval);
+  clock_time_t next_link = VT_NEVER;
+  clock_time_t join = SECONDS(opt.join);
+  clock_time_t now = 0;
+  clock_time_t next;
+  uint8_t link_up = 1;
+  int i;
+
+  if(opt.fail_every > 0) {
+    next_link = SECONDS(opt.fail_every * (0.5 + uniform()));
+  }
+  if(replay != NULL) {
+    next_line = replay_next() ? replay_at : VT_NEVER;
+  }
+
+  vt_init(opt.seed);
+  vt_mqtt_init(&opt.link, deliver);
+  for(i = 0; autostart_processes[i] != NULL; i++) {
+    process_start(autostart_processes[i], NULL);
+  }
+  vt_run();
+
+  while(now < end) {
+    next = MIN(MIN(vt_next_timer(), next_line), MIN(next_link, end));
+    next = MIN(next, join);
+    state_time[state_index()] += next - now;
+    now = next;
+    vt_advance(now);
+
+    if(now == join) {
+      join = VT_NEVER;
+      vt_net_up();
+    }
+    if(now == next_link) {
+      link_up = !link_up;
+      vt_mqtt_link(link_up);
+      if(link_up) {
+        down_time += SECONDS(opt.outage);
+        next_link = now + SECONDS(opt.fail_every * (0.5 + uniform()));
+        recovering = 1;
+        recovering_since = now;
+      } else {
+        outages++;
+        next_link = now + SECONDS(opt.outage);
+      }
+      vt_run();
+    }
+    if(now == next_line && replay != NULL) {
+      next_line = replay_line_due(now);
+    } else if(now == next_line) {
+      send_line();
+      next_line = now + SECONDS(opt.line_interval);
+    }
+
+    if(recovering && link_up && publishing()) {
+      recovering = 0;
+      recoveries++;
+      recovery_sum += now - recovering_since;
+      recovery_max = MAX(recovery_max, now - recovering_since);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+compare(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+
+  return x < y ? -1 : x > y;
+}
+/*---------------------------------------------------------------------------*/
+static double
+mean(const struct latencies *l)
+{
+  double sum = 0;
+  uint32_t i;
+
+  for(i = 0; i < l->count; i++) {
+    sum += l->ms[i];
+  }
+  return l->count ? sum / l->count : 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Nearest rank, on a sorted set */
+static double
+percentile(const struct latencies *l, unsigned p)
+{
+  if(l->count == 0) {
+    return 0;
+  }
+  return l->ms[(l->count * p + 99) / 100 - (l->count * p > 0)];
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_latency(const char *what, struct latencies *l)
+{
+  qsort(l->ms, l->count, sizeof(double), compare);
+  printf("  %-8s %7lu rows, mean %8.0f ms, p50 %8.0f, p95 %8.0f, max %8.0f\n",
+         what, (unsigned long)l->count, mean(l), percentile(l, 50),
+         percentile(l, 95), l->count ? l->ms[l->count - 1] : 0.0);
+}
+/*---------------------------------------------------------------------------*/
+static void
+json_latency(FILE *f, const char *what, const struct latencies *l)
+{
+  fprintf(f, "  \"%s_rows\": %lu,\n", what, (unsigned long)l->count);
+  fprintf(f, "  \"%s_mean_ms\": %.0f,\n", what, mean(l));
+  fprintf(f, "  \"%s_p50_ms\": %.0f,\n", what, percentile(l, 50));
+  fprintf(f, "  \"%s_p95_ms\": %.0f,\n", what, percentile(l, 95));
+  fprintf(f, "  \"%s_max_ms\": %.0f,\n", what,
+          l->count ? l->ms[l->count - 1] : 0.0);
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_hist(const char *what, const struct lat_hist *h)
+{
+  printf("  %-9s %7lu %7lu %7lu %7lu\n", what,
+         (unsigned long)lat_hist_percentile(h, 50),
+         (unsigned long)lat_hist_percentile(h, 90),
+         (unsigned long)lat_hist_percentile(h, 99), (unsigned long)h->max);
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(double wall)
+{
+  const struct vt_mqtt_stats *s = vt_mqtt_stats();
+  clock_time_t total = SECONDS(opt.hours * 3600);
+  uint32_t got = routine.count + alarms.count;
+  uint32_t rows = replay != NULL ? rows_received : got;
+  FILE *f;
+  uint8_t i;
+
+  printf("vtime: %.1f h in %.2f s (%.0fx), seed %u\n", opt.hours, wall,
+         wall > 0 ? opt.hours * 3600 / wall : 0.0, opt.seed);
+  if(replay != NULL) {
+    /* Field lines carry no number to match them up: rows only */
+    printf("Replay: %lu lines from %s at %gx, %lu rows received\n",
+           (unsigned long)lines_sent, opt.replay, opt.speed,
+           (unsigned long)rows_received);
+  } else {
+    printf("Lines: %lu sent, %lu delivered (%.2f%%), %lu duplicates\n",
+           (unsigned long)lines_sent, (unsigned long)got,
+           lines_sent ? 100.0 * got / lines_sent : 0.0,
+           (unsigned long)duplicates);
+  }
+  printf("Publishes: %lu (%lu bytes), %.1f per hour, %.2f rows each, "
+         "%lu lost in flight\n", (unsigned long)s->publishes,
+         (unsigned long)s->bytes, s->publishes / opt.hours,
+         s->publishes ? (double)rows / s->publishes : 0.0,
+         (unsigned long)s->lost);
+  if(replay == NULL) {
+    printf("Latency, UART to broker:\n");
+    print_latency("lines", &routine);
+    print_latency("alarms", &alarms);
+  }
+  printf("Connection: %lu connects (%lu resumed), %lu failed, %lu dropped, "
+         "%lu subscribes, %lu pings, keep-alive %u s\n",
+         (unsigned long)s->connects, (unsigned long)s->resumed,
+         (unsigned long)s->connect_failures, (unsigned long)s->drops,
+         (unsigned long)s->subscribes, (unsigned long)s->pings,
+         keep_alive_period());
+  printf("Outages: %lu (%.0f s down), back to publishing after mean %.1f s, "
+         "max %.1f s\n", (unsigned long)outages, TO_MS(down_time) / 1000,
+         recoveries ? TO_MS(recovery_sum) / 1000 / recoveries : 0.0,
+         TO_MS(recovery_max) / 1000);
+  printf("Node histograms (lat-hist.c), p50/p90/p99/max ms:\n");
+  print_hist("lat_uart", &hist_uart);
+  print_hist("lat_pub", &hist_pub);
+  print_hist("lat_recon", &hist_recon);
+  printf("State time:");
+  for(i = 0; i < STATES; i++) {
+    if(state_time[i] > 0) {
+      printf(" %s %.2f%%", state_names[i], 100.0 * state_time[i] / total);
+    }
+  }
+  printf("\n");
+
+  if(opt.json == NULL) {
+    return;
+  }
+  f = fopen(opt.json, "w");
+  if(f == NULL) {
+    perror(opt.json);
+    exit(1);
+  }
+  fprintf(f, "{\n");
+  fprintf(f, "  \"hours\": %g,\n", opt.hours);
+  fprintf(f, "  \"seed\": %u,\n", opt.seed);
+  fprintf(f, "  \"lines_sent\": %lu,\n", (unsigned long)lines_sent);
+  fprintf(f, "  \"lines_delivered\": %lu,\n", (unsigned long)got);
+  fprintf(f, "  \"duplicates\": %lu,\n", (unsigned long)duplicates);
+  fprintf(f, "  \"publishes\": %lu,\n", (unsigned long)s->publishes);
+  fprintf(f, "  \"publish_bytes\": %lu,\n", (unsigned long)s->bytes);
+  fprintf(f, "  \"lost_in_flight\": %lu,\n", (unsigned long)s->lost);
+  json_latency(f, "line", &routine);
+  json_latency(f, "alarm", &alarms);
+  fprintf(f, "  \"connects\": %lu,\n", (unsigned long)s->connects);
+  fprintf(f, "  \"resumed\": %lu,\n", (unsigned long)s->resumed);
+  fprintf(f, "  \"connect_failures\": %lu,\n",
+          (unsigned long)s->connect_failures);
+  fprintf(f, "  \"drops\": %lu,\n", (unsigned long)s->drops);
+  fprintf(f, "  \"subscribes\": %lu,\n", (unsigned long)s->subscribes);
+  fprintf(f, "  \"pings\": %lu,\n", (unsigned long)s->pings);
+  fprintf(f, "  \"outages\": %lu,\n", (unsigned long)outages);
+  fprintf(f, "  \"recovery_mean_ms\": %.0f,\n",
+          recoveries ? TO_MS(recovery_sum) / recoveries : 0.0);
+  fprintf(f, "  \"recovery_max_ms\": %.0f,\n", TO_MS(recovery_max));
+  for(i = 0; i < STATES; i++) {
+    fprintf(f, "  \"state_%s_pct\": %.3f%s\n", state_names[i],
+            100.0 * state_time[i] / total, i < STATES - 1 ? "," : "");
+  }
+  fprintf(f, "}\n");
+  fclose(f);
+}
+/*---------------------------------------------------------------------------*/
+static void
+usage(const char *name)
+{
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  --hours H           simulated time (24, or the length of the "
+          "replay)\n"
+          "  --line-interval S   one UART line every S seconds (10)\n"
+          "  --alarm-every N     every Nth line is an alarm (0: none)\n"
+          "  --channels N        tag lines ch0..chN-1 in turn (0: untagged)\n"
+          "  --fail-every S      link outage every S seconds on average "
+          "(0: none)\n"
+          "  --outage S          outage length (120)\n"
+          "  --nat-idle S        NAT forgets idle connections (0: never)\n"
+          "  --rtt MS            round trip to the broker (200)\n"
+          "  --tcp-timeout S     TCP gives up after S seconds (60)\n"
+          "  --seed N            random seed (1)\n"
+          "  --replay FILE       send the U records of a trace instead\n"
+          "  --speed X           replay X times faster (1)\n"
+          "  --trace-out FILE    write this run's trace records\n"
+          "  --json FILE         write the results as JSON\n"
+          "  --log               print the application's output\n", name);
+  exit(2);
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  static const struct option options[] = {
+    { "hours", required_argument, NULL, 'H' },
+    { "line-interval", required_argument, NULL, 'i' },
+    { "alarm-every", required_argument, NULL, 'a' },
+    { "channels", required_argument, NULL, 'c' },
+    { "fail-every", required_argument, NULL, 'f' },
+    { "outage", required_argument, NULL, 'o' },
+    { "nat-idle", required_argument, NULL, 'n' },
+    { "rtt", required_argument, NULL, 'r' },
+    { "tcp-timeout", required_argument, NULL, 't' },
+    { "seed", required_argument, NULL, 's' },
+    { "json", required_argument, NULL, 'j' },
+    { "log", no_argument, NULL, 'l' },
+    { "replay", required_argument, NULL, 'R' },
+    { "speed", required_argument, NULL, 'S' },
+    { "trace-out", required_argument, NULL, 'T' },
+    { NULL, 0, NULL, 0 }
+  };
+  double rtt_ms = 200, tcp_timeout = 60, nat_idle = 0;
+  const char *trace_out = NULL;
+  int hours_set = 0;
+  struct timespec t0, t1;
+  int c;
+
+  while((c = getopt_long(argc, argv, "", options, NULL)) != -1) {
+    switch(c) {
+    case 'H': opt.hours = atof(optarg); hours_set = 1; break;
+    case 'i': opt.line_interval = atof(optarg); break;
+    case 'a': opt.alarm_every = atoi(optarg); break;
+    case 'c': opt.channels = atoi(optarg); break;
+    case 'f': opt.fail_every = atof(optarg); break;
+    case 'o': opt.outage = atof(optarg); break;
+    case 'n': nat_idle = atof(optarg); break;
+    case 'r': rtt_ms = atof(optarg); break;
+    case 't': tcp_timeout = atof(optarg); break;
+    case 's': opt.seed = atoi(optarg); break;
+    case 'j': opt.json = optarg; break;
+    case 'l': opt.log = 1; break;
+    case 'R': opt.replay = optarg; break;
+    case 'S': opt.speed = atof(optarg); break;
+    case 'T': trace_out = optarg; break;
+    default: usage(argv[0]);
+    }
+  }
+  if(opt.speed <= 0) {
+    usage(argv[0]);
+  }
+  if(opt.replay != NULL) {
+    replay = fopen(opt.replay, "r");
+    if(replay == NULL) {
+      perror(opt.replay);
+      return 1;
+    }
+    /* By default, up to the last line and ten minutes to publish it */
+    while(replay_next());
+    if(!hours_set) {
+      opt.hours = (TO_MS(replay_at) / 1000 + 600) / 3600;
+    }
+    rewind(replay);
+    replay_at = 0;
+  }
+  if(trace_out != NULL) {
+    opt.trace = fopen(trace_out, "w");
+    if(opt.trace == NULL) {
+      perror(trace_out);
+      return 1;
+    }
+  }
+  if(opt.hours <= 0 || opt.line_interval <= 0 || opt.outage <= 0 ||
+     (opt.fail_every > 0 && opt.fail_every <= opt.outage)) {
+    usage(argv[0]);
+  }
+
+  opt.link.rtt = MAX(1, SECONDS(rtt_ms / 1000));
+  opt.link.tcp_timeout = SECONDS(tcp_timeout);
+  opt.link.nat_idle = SECONDS(nat_idle);
+  xorshift_state = opt.seed * 2654435761U + 1;
+
+  lines_max = opt.hours * 3600 / opt.line_interval + 1;
+  delivered = calloc(lines_max, 1);
+  routine.ms = calloc(lines_max, sizeof(double));
+  alarms.ms = calloc(lines_max, sizeof(double));
+  if(delivered == NULL || routine.ms == NULL || alarms.ms == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  run();
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  report(t1.tv_sec - t0.tv_sec + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+  if(opt.trace != NULL) {
+    fclose(opt.trace);
+  }
+
+  return vt_mqtt_check_pings() ? 0 : 1;
+}
+/*---------------------------------------------------------------------------*/